@@ -0,0 +1,71 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _UTILS_ARENA_H_
+#define _UTILS_ARENA_H_
+
+#include "esp32-utils/utils.h"
+
+/***********************************************************************************************************
+ * Arena
+ ***********************************************************************************************************/
+// Bump pointer allocator for objects that die together, such as the ones created while
+// handling a request. Collections created with the *_new_in constructors allocate their
+// header and storage from the arena. Freeing them is optional: utils_arena_reset releases
+// everything at once, after which they must not be used anymore.
+// The allocation functions fall back to the heap when arena is NULL.
+typedef struct _utils_arena *utils_arena_t;
+typedef void(utils_arena_cleanup)(void *data);
+
+// chunk_size is the size of the first chunk. More chunks are added when it runs out
+utils_arena_t utils_arena_new(size_t chunk_size);
+void utils_arena_free(void *arena);
+// Run the cleanups, last registered first, and release all the allocations
+void utils_arena_reset(utils_arena_t arena);
+// Bytes allocated since the last reset
+size_t utils_arena_used(utils_arena_t arena);
+void *utils_arena_malloc(utils_arena_t arena, size_t size);
+// The last block allocated grows in place, others are copied
+void *utils_arena_realloc(utils_arena_t arena, void *ptr, size_t old_size, size_t size);
+// size is the size the block was allocated or last reallocated with. The blocks at the top of
+// the arena are given back, so releasing in the reverse order of allocation frees them all.
+// Others stay allocated until the reset
+void utils_arena_release(utils_arena_t arena, void *ptr, size_t size);
+char *utils_arena_strdup(utils_arena_t arena, const char *string);
+// Call cleanup(data) on reset, for resources that don't live in the arena
+int utils_arena_add_cleanup(utils_arena_t arena, utils_arena_cleanup *cleanup, void *data);
+
+#endif
+#ifdef __cplusplus
+}
+#endif
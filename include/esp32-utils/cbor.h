@@ -0,0 +1,116 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _UTILS_CBOR_H_
+#define _UTILS_CBOR_H_
+
+#include "esp32-utils/utils.h"
+
+typedef void(element_free)(void *element);
+typedef struct _array *array_t;
+typedef struct _map *map_t;
+typedef struct _buffer *buffer_t;
+
+// Containers nested deeper than this are rejected, to bound the stack
+#ifndef CBOR_MAX_DEPTH
+#define CBOR_MAX_DEPTH              16
+#endif
+
+/***********************************************************************************************************
+ * CBOR
+ ***********************************************************************************************************/
+// Values are written as a subset of CBOR (RFC 8949). The elements of arrays and the values of maps
+// are typed by the free callback of their container, so containers must be homogeneous:
+//   cbor_uint_free     CBOR_TYPE_UINT, integers stored in the pointers
+//   free               CBOR_TYPE_STRING, \0 terminated strings
+//   buffer_free        CBOR_TYPE_BUFFER
+//   utils_mpi_free     CBOR_TYPE_MPI, written as positive bignums, like buffer_append_mpi.
+//                      Negative MPIs fail with UTILS_ERR_NOT_SUPPORTED. utils_mpi_release too
+//   array_free         CBOR_TYPE_ARRAY
+//   map_free           CBOR_TYPE_MAP
+// NULL elements of the other types are written as CBOR null. Containers without a free callback
+// may only hold NULL elements, so that borrowed pointers are never written out as integers.
+typedef enum {
+    CBOR_TYPE_UINT,
+    CBOR_TYPE_STRING,
+    CBOR_TYPE_BUFFER,
+    CBOR_TYPE_MPI,
+    CBOR_TYPE_ARRAY,
+    CBOR_TYPE_MAP,
+    CBOR_TYPE_NULL,
+} cbor_type_t;
+
+// Free callback of containers of integers, which does nothing
+void cbor_uint_free(void *element);
+// NULL gives CBOR_TYPE_NULL. Fails with UTILS_ERR_NOT_SUPPORTED for other callbacks
+int cbor_type_for_free_callback(element_free *free_callback, cbor_type_t *type);
+element_free *cbor_free_callback_for_type(cbor_type_t type);
+
+// Append value, of type, in one pass. On error the buffer is left as it was. UTILS_ERR_NOT_SUPPORTED
+// is returned for a container nested too deep or with elements its free callback can't type
+int cbor_append(buffer_t buffer, cbor_type_t type, void *value);
+int cbor_append_array(buffer_t buffer, array_t array);
+int cbor_append_map(buffer_t buffer, map_t map);
+
+// Rebuild the value encoded in the len bytes of data, which must hold exactly one value.
+// Decoded containers get the free callback of their first non null element, or NULL when
+// they only hold nulls. Return UTILS_ERR_INVALID_DATA for anything that cbor_append doesn't
+// write, including truncated data, strings holding a \0 and maps with a key twice
+int cbor_decode(const unsigned char *data, int len, cbor_type_t *type, void **value);
+
+// An item met while visiting encoded data, pointing into it
+typedef struct {
+    cbor_type_t type;
+    // 0 for the top level value
+    int depth;
+    // Key of the item if it is a map value, not \0 terminated, or NULL
+    const char *key;
+    int key_length;
+    // The integer of CBOR_TYPE_UINT, the number of elements or entries of containers
+    uint64_t value;
+    // The bytes of strings, buffers and MPIs (big endian)
+    const unsigned char *data;
+    int length;
+} cbor_item_t;
+
+// Return UTILS_ERR_OK to carry on
+typedef int(cbor_visitor)(void *context, const cbor_item_t *item);
+
+// Call visitor for every item, containers before their content, without allocating.
+// Return what the visitor returned if it stopped, or an error if data isn't valid
+int cbor_visit(const unsigned char *data, int len, cbor_visitor *visitor, void *context);
+
+#endif
+#ifdef __cplusplus
+}
+#endif
@@ -35,37 +35,187 @@ extern "C" {
 
 #include "esp32-utils/utils.h"
 
+typedef struct _utils_arena *utils_arena_t;
+
 #define UTILS_BUFFER_NO_LIMIT       -1
+// Payloads up to this size are stored in the buffer object itself
+#ifndef UTILS_BUFFER_INLINE_SIZE
+#define UTILS_BUFFER_INLINE_SIZE    32
+#endif
+// Buffer growth policies, as a percentage of the current size
+#define UTILS_BUFFER_GROWTH_FIXED   0
+#define UTILS_BUFFER_GROWTH_EXACT   100
+#define UTILS_BUFFER_GROWTH_DOUBLE  200
 
 /***********************************************************************************************************
  * Array
  ***********************************************************************************************************/
 typedef void(element_free)(void *element);
+// Negative, zero or positive as a sorts before, the same as or after b
+typedef int(element_compare)(const void *a, const void *b);
+typedef bool(element_predicate)(void *element, void *context);
 typedef struct _array *array_t;
 
 array_t array_new(element_free *free_callback);
+array_t array_new_in(utils_arena_t arena, element_free *free_callback);
 // Make compatible with free()
 void array_free(void *array);
 int array_count(array_t array);
+// Number of elements the array can hold before it needs to grow
+int array_capacity(array_t array);
+element_free *array_get_free_callback(array_t array);
+int array_reserve(array_t array, int capacity);
+int array_shrink_to_fit(array_t array);
 int array_push(array_t array, void *element);
 void *array_pop(array_t array);
+// Removing never reallocates, use array_shrink_to_fit to give memory back
 void *array_remove_at(array_t array, int index);
 void *array_replace(array_t array, int index, void *element);
 void *array_at(array_t array, int index);
+// index can be array_count, to append. Fails with UTILS_ERR_OUT_OF_RANGE past that
+int array_insert_at(array_t array, int index, void *element);
+int array_push_many(array_t array, void * const *elements, int count);
+// Unlike array_remove_at, these functions pass the elements they remove to free_callback.
+// Memory isn't given back, use array_shrink_to_fit for that
+int array_remove_range(array_t array, int index, int count);
+// Remove the elements for which predicate returns true. Return the number removed
+int array_remove_if(array_t array, element_predicate *predicate, void *context);
+void array_clear(array_t array);
+// In place and not stable. The recursion depth is bounded by log2 of the count
+void array_sort(array_t array, element_compare *compare);
+// The functions below expect the array to be sorted with the same comparison.
+// Index of the first element not before element, array_count if there is none
+int array_lower_bound(array_t array, const void *element, element_compare *compare);
+// Index of an element equal to element, or -1
+int array_bsearch(array_t array, const void *element, element_compare *compare);
+// Insert element after the elements equal to it. Return its index, or UTILS_ERR_ALLOC_FAILED
+int array_insert_sorted(array_t array, void *element, element_compare *compare);
+
+/***********************************************************************************************************
+ * Deque
+ ***********************************************************************************************************/
+// Double-ended queue on a ring of pointers: pushing and popping at either end doesn't move the
+// other elements. Elements are owned like in arrays
+typedef struct _deque *deque_t;
+
+deque_t deque_new(element_free *free_callback);
+deque_t deque_new_in(utils_arena_t arena, element_free *free_callback);
+// Make compatible with free()
+void deque_free(void *deque);
+int deque_count(deque_t deque);
+int deque_capacity(deque_t deque);
+int deque_reserve(deque_t deque, int capacity);
+int deque_push_back(deque_t deque, void *element);
+int deque_push_front(deque_t deque, void *element);
+// Return NULL if the deque is empty
+void *deque_pop_front(deque_t deque);
+void *deque_pop_back(deque_t deque);
+// index 0 is the front
+void *deque_at(deque_t deque, int index);
+void *deque_replace(deque_t deque, int index, void *element);
+// Pass all the elements to free_callback
+void deque_clear(deque_t deque);
+
+/***********************************************************************************************************
+ * Priority queue
+ ***********************************************************************************************************/
+// Binary heap of elements, the first in compare order on top. Elements are owned like in arrays.
+// Each element gets a handle, to change its priority or to remove it. Handles of elements that
+// left the queue are reused
+typedef struct _pqueue *pqueue_t;
+
+pqueue_t pqueue_new(element_compare *compare, element_free *free_callback);
+pqueue_t pqueue_new_in(utils_arena_t arena, element_compare *compare, element_free *free_callback);
+// Make compatible with free()
+void pqueue_free(void *queue);
+int pqueue_count(pqueue_t queue);
+// Return the handle of element, or UTILS_ERR_ALLOC_FAILED
+int pqueue_push(pqueue_t queue, void *element);
+// The top element, or NULL if the queue is empty
+void *pqueue_peek(pqueue_t queue);
+void *pqueue_pop(pqueue_t queue);
+void *pqueue_get(pqueue_t queue, int handle);
+// Restore the order after the priority of the element of handle changed, either way
+int pqueue_update(pqueue_t queue, int handle);
+// Take out the element of handle and return it, or NULL if handle isn't in the queue
+void *pqueue_remove(pqueue_t queue, int handle);
+// Pass all the elements to free_callback
+void pqueue_clear(pqueue_t queue);
 
 /***********************************************************************************************************
  * Map
  ***********************************************************************************************************/
 typedef struct _map *map_t;
+typedef struct _intern_pool *intern_pool_t;
+
+// Entries are visited in insertion order, which removals keep. A removed entry leaves a hole
+// that is skipped. Holes are compacted away by later updates once they outnumber the entries,
+// so removal takes amortized constant time
+typedef struct {
+    map_t map;
+    int index;
+    const char *key;
+    void *value;
+} map_iterator_t;
 
 map_t map_new(element_free *free_callback);
+map_t map_new_in(utils_arena_t arena, element_free *free_callback);
+// Keys are interned in pool, which can be shared between maps and must outlive them
+map_t map_new_with_pool(intern_pool_t pool, element_free *free_callback);
 void map_free(void *m);
 int map_count(map_t map);
+// Lookups don't modify the map, so a map can be read by several tasks as long as none updates it
 void *map_value_for_key(map_t map, const char *key);
 void *map_set_value_for_key(map_t map, const char *key, void *value);
+// Add an entry for a key that isn't in the map yet. Return UTILS_ERR_IN_USE if it is,
+// or UTILS_ERR_ALLOC_FAILED, leaving the map as it was
+int map_insert(map_t map, const char *key, void *value);
 void *map_remove_value_for_key(map_t map, const char *key);
+// Keys and values in insertion order. The arrays belong to the map and must not be modified.
+// Holes left by removals are compacted first, so unlike the iterator these may update the map
 array_t map_keys(map_t map);
 array_t map_values(map_t map);
+// Callback the values are freed with
+element_free *map_get_free_callback(map_t map);
+void map_iterator_init(map_iterator_t *iterator, map_t map);
+bool map_iterator_next(map_iterator_t *iterator);
+// Remove the current entry and return its value. Iteration carries on with the next entry,
+// the map is only compacted by the updates made after the iteration
+void *map_iterator_remove(map_iterator_t *iterator);
+
+/***********************************************************************************************************
+ * Intern pool
+ ***********************************************************************************************************/
+// Stores each distinct string once, with a reference count. Not thread safe
+intern_pool_t intern_pool_new(void);
+void intern_pool_free(void *pool);
+// Number of distinct strings
+int intern_pool_count(intern_pool_t pool);
+// Return the pooled copy of string and take a reference to it
+const char *intern_pool_acquire(intern_pool_t pool, const char *string);
+void intern_pool_release(intern_pool_t pool, const char *string);
+
+/***********************************************************************************************************
+ * Concurrent map
+ ***********************************************************************************************************/
+// Map shared between tasks. Lookups take no lock, updates are serialized and copy the whole map,
+// so it suits data that is read much more often than it changes. Values replaced or removed are
+// only passed to free_callback once no reader can still see them
+typedef struct _concurrent_map *concurrent_map_t;
+
+concurrent_map_t concurrent_map_new(element_free *free_callback);
+// No reader or writer may be using the map
+void concurrent_map_free(void *map);
+// Lookups, and the values they return, are only valid between read_begin and read_end, which
+// must be called from the same task
+int concurrent_map_read_begin(concurrent_map_t map);
+void concurrent_map_read_end(concurrent_map_t map, int token);
+int concurrent_map_count(concurrent_map_t map);
+void *concurrent_map_value_for_key(concurrent_map_t map, const char *key);
+// Writers block until readers of the previous version are done, they must not be in a read section.
+// On UTILS_ERR_ALLOC_FAILED the map is left unchanged. Removing a missing key succeeds
+int concurrent_map_set_value_for_key(concurrent_map_t map, const char *key, void *value);
+int concurrent_map_remove_value_for_key(concurrent_map_t map, const char *key);
 
 /***********************************************************************************************************
  * Buffer
@@ -73,26 +223,162 @@ array_t map_values(map_t map);
 typedef struct _buffer *buffer_t;
 
 buffer_t buffer_new(int size);
+buffer_t buffer_new_in(utils_arena_t arena, int size);
 buffer_t buffer_new_from_data(unsigned char *data, int size);
 buffer_t buffer_new_from_static_data(const unsigned char *data, int size);
 buffer_t buffer_new_from_string(char *string);
 buffer_t buffer_new_from_mpi(mbedtls_mpi *mpi);
+// Read-only view on len bytes of parent, starting at offset. The slice shares the storage of
+// parent, which is kept alive until all its slices are freed. Appending to a slice fails
+// with UTILS_ERR_READ_ONLY
+buffer_t buffer_slice(buffer_t parent, int offset, int len);
+bool buffer_is_slice(buffer_t buffer);
 buffer_t buffer_clone(buffer_t buffer);
 // Size of the useful data. Doesn't include a string \0 terminator
 int buffer_get_length(buffer_t buffer);
 // If data is a string, it is \0 terminated
 const unsigned char *buffer_get_data(buffer_t buffer);
 // Detach the data buffer form the buffer object. Caller is responsible for freeing
+// Return NULL if the buffer is a slice or has slices
 unsigned char *buffer_detach_data(buffer_t buffer);
 int buffer_append(buffer_t buffer, const unsigned char *data, int len);
 int buffer_append_string(buffer_t buffer, const char *data);
 int buffer_append_buffer(buffer_t buffer, const buffer_t data);
 int buffer_append_mpi(buffer_t buffer, mbedtls_mpi *data);
+// Append data big endian on exactly width bytes, zero padded on the left. Fails with
+// UTILS_ERR_BUFFER_TOO_SMALL if data doesn't fit in width
+int buffer_append_mpi_padded(buffer_t buffer, mbedtls_mpi *data, int width);
+// Append count MPIs in one go, each on width bytes, or on its own size if width is 0
+int buffer_append_mpis(buffer_t buffer, mbedtls_mpi **data, int count, int width);
+// Read the big endian MPI stored on len bytes at offset
+int buffer_read_mpi(buffer_t buffer, int offset, int len, mbedtls_mpi *mpi);
+// Read count MPIs stored back to back on width bytes each, starting at offset
+int buffer_read_mpis(buffer_t buffer, int offset, int width, mbedtls_mpi **mpis, int count);
+// Append data as lowercase hex, or standard base64 with padding
+int buffer_append_hex(buffer_t buffer, const unsigned char *data, int len);
+int buffer_append_base64(buffer_t buffer, const unsigned char *data, int len);
+// Append the bytes decoded from hex, in either case, or base64 with or without padding.
+// Return UTILS_ERR_INVALID_DATA, and append nothing, if the input isn't valid
+int buffer_append_from_hex(buffer_t buffer, const char *hex, int len);
+int buffer_append_from_base64(buffer_t buffer, const char *base64, int len);
+// When an append runs out of space, the buffer grows to growth percent of its size, or to what is
+// needed if that's more. UTILS_BUFFER_GROWTH_FIXED never grows. Buffers never grow past max_size,
+// unless it is UTILS_BUFFER_NO_LIMIT. Appends that don't fit fail with UTILS_ERR_BUFFER_TOO_SMALL.
+// New buffers double with no limit.
+void buffer_set_growth(buffer_t buffer, int growth, int max_size);
 int buffer_ensure_available(buffer_t buffer, int len);
 int buffer_resize(buffer_t buffer, int new_len);
 void buffer_reset(buffer_t buffer);
+// Drop the data past len
+int buffer_truncate(buffer_t buffer, int len);
 void buffer_free(void *p);
 
+/***********************************************************************************************************
+ * Buffer reader
+ ***********************************************************************************************************/
+// Bounds checked cursor over the data of a buffer. The first read past the end, or of invalid data,
+// sets the error and every later read fails, returning 0 or NULL and reading nothing, so a whole
+// frame can be parsed and checked once at the end. Fields are pointers into the buffer, valid as
+// long as it isn't modified
+typedef struct {
+    buffer_t buffer;
+    const unsigned char *data;
+    int length;
+    int pos;
+    int error;
+} buffer_reader_t;
+
+// Length prefix for buffer_reader_field, other than 1, 2 or 4 bytes big endian
+#define BUFFER_READER_PREFIX_VARINT 0
+
+void buffer_reader_init(buffer_reader_t *reader, buffer_t buffer);
+// Read raw data. There is no buffer to slice, so buffer_reader_slice fails with UTILS_ERR_NOT_SUPPORTED
+void buffer_reader_init_data(buffer_reader_t *reader, const unsigned char *data, int len);
+// UTILS_ERR_OK, UTILS_ERR_BUFFER_TOO_SMALL if a read went past the end, or the first other error met
+int buffer_reader_error(buffer_reader_t *reader);
+int buffer_reader_position(buffer_reader_t *reader);
+int buffer_reader_remaining(buffer_reader_t *reader);
+uint8_t buffer_reader_u8(buffer_reader_t *reader);
+uint16_t buffer_reader_u16_be(buffer_reader_t *reader);
+uint16_t buffer_reader_u16_le(buffer_reader_t *reader);
+uint32_t buffer_reader_u32_be(buffer_reader_t *reader);
+uint32_t buffer_reader_u32_le(buffer_reader_t *reader);
+uint64_t buffer_reader_u64_be(buffer_reader_t *reader);
+uint64_t buffer_reader_u64_le(buffer_reader_t *reader);
+// Unsigned LEB128, as in protobuf, up to 64 bits. Longer encodings are UTILS_ERR_INVALID_DATA
+uint64_t buffer_reader_varint(buffer_reader_t *reader);
+void buffer_reader_skip(buffer_reader_t *reader, int len);
+// Return the next len bytes in place
+const unsigned char *buffer_reader_bytes(buffer_reader_t *reader, int len);
+// Return a field in place and its length in len. The length comes first, on prefix bytes big
+// endian, or as a varint for BUFFER_READER_PREFIX_VARINT
+const unsigned char *buffer_reader_field(buffer_reader_t *reader, int prefix, int *len);
+// Return the next len bytes as a slice of the buffer, to free with buffer_free
+buffer_t buffer_reader_slice(buffer_reader_t *reader, int len);
+// Read a big endian MPI stored on len bytes. Return the error state
+int buffer_reader_mpi(buffer_reader_t *reader, int len, mbedtls_mpi *mpi);
+
+/***********************************************************************************************************
+ * Buffer chain
+ ***********************************************************************************************************/
+typedef struct _buffer_chain *buffer_chain_t;
+
+typedef struct {
+    const unsigned char *data;
+    int length;
+} buffer_segment_t;
+
+typedef struct {
+    buffer_chain_t chain;
+    int index;
+} buffer_chain_iterator_t;
+
+buffer_chain_t buffer_chain_new(void);
+void buffer_chain_free(void *chain);
+// Release all the segments
+void buffer_chain_reset(buffer_chain_t chain);
+int buffer_chain_get_length(buffer_chain_t chain);
+int buffer_chain_segment_count(buffer_chain_t chain);
+// Copy data at the end of the chain
+int buffer_chain_append(buffer_chain_t chain, const unsigned char *data, int len);
+int buffer_chain_append_string(buffer_chain_t chain, const char *data);
+int buffer_chain_append_mpi(buffer_chain_t chain, mbedtls_mpi *data);
+// Append buffer by reference. The chain keeps it alive and reads its current content when iterated
+int buffer_chain_append_buffer(buffer_chain_t chain, buffer_t buffer);
+void buffer_chain_iterator_init(buffer_chain_iterator_t *iterator, buffer_chain_t chain);
+bool buffer_chain_next_segment(buffer_chain_iterator_t *iterator, buffer_segment_t *segment);
+// Fill up to max segments, like an iovec. Return the number of segments filled
+int buffer_chain_get_segments(buffer_chain_t chain, buffer_segment_t *segments, int max);
+// Copy the whole chain in a new contiguous buffer
+buffer_t buffer_chain_flatten(buffer_chain_t chain);
+
+/***********************************************************************************************************
+ * Ring buffer
+ ***********************************************************************************************************/
+// Fixed capacity byte ring for one producer and one consumer, which can run concurrently without
+// locks. The producer side doesn't allocate and is in IRAM, so it can be used from an ISR as long
+// as the ring itself is in internal memory
+typedef struct _ring_buffer *ring_buffer_t;
+
+// The capacity is rounded up to a power of two
+ring_buffer_t ring_buffer_new(int capacity);
+void ring_buffer_free(void *ring);
+int ring_buffer_capacity(ring_buffer_t ring);
+// Bytes waiting to be consumed
+int ring_buffer_get_length(ring_buffer_t ring);
+// Producer. Return the contiguous free region and its length in len, which is 0 if the ring is
+// full. Fill it then commit what was written
+unsigned char *ring_buffer_reserve(ring_buffer_t ring, int *len);
+void ring_buffer_commit(ring_buffer_t ring, int len);
+// Copy as much of data as fits and return how much that was
+int ring_buffer_write(ring_buffer_t ring, const unsigned char *data, int len);
+// Consumer. Return the contiguous region waiting to be consumed and its length in len, which is 0
+// if the ring is empty. Data stays in place until consumed
+const unsigned char *ring_buffer_peek(ring_buffer_t ring, int *len);
+void ring_buffer_consume(ring_buffer_t ring, int len);
+// Copy up to len bytes out and return how many there were
+int ring_buffer_read(ring_buffer_t ring, unsigned char *data, int len);
+
 #endif
 #ifdef __cplusplus
 }
@@ -36,11 +36,81 @@ extern "C" {
 #include "esp32-utils/utils.h"
 
 typedef struct _buffer *buffer_t;
+typedef struct _utils_stats utils_stats_t;
 
+// Size of the block, on the stack, in which lines are formatted before being written out
+#ifndef UTILS_DUMP_BLOCK_SIZE
+#define UTILS_DUMP_BLOCK_SIZE       256
+#endif
+
+// Asynchronous mode: number of queued dumps, a power of two, and the bytes kept of each.
+// Longer dumps are truncated
+#ifndef UTILS_DUMP_ASYNC_SLOTS
+#define UTILS_DUMP_ASYNC_SLOTS      32
+#endif
+#ifndef UTILS_DUMP_ASYNC_SLOT_SIZE
+#define UTILS_DUMP_ASYNC_SLOT_SIZE  256
+#endif
+// Longest description kept, including the terminator
+#ifndef UTILS_DUMP_ASYNC_DESCRIPTION_SIZE
+#define UTILS_DUMP_ASYNC_DESCRIPTION_SIZE 32
+#endif
+#ifndef UTILS_DUMP_ASYNC_STACK_SIZE
+#define UTILS_DUMP_ASYNC_STACK_SIZE 3072
+#endif
+#ifndef UTILS_DUMP_ASYNC_PRIORITY
+#define UTILS_DUMP_ASYNC_PRIORITY   1
+#endif
+// How long the worker sleeps when the queue is empty
+#ifndef UTILS_DUMP_ASYNC_POLL_MS
+#define UTILS_DUMP_ASYNC_POLL_MS    10
+#endif
+
+// Receives the formatted output, a block at a time
+typedef void(dump_sink)(void *context, const char *data, size_t len);
+
+// context is a FILE *, or NULL for stdout. This is the default sink
+void dump_sink_file(void *context, const char *data, size_t len);
+// context is a buffer_t the output is appended to
+void dump_sink_buffer(void *context, const char *data, size_t len);
+// Set the sink used by the dump functions, NULL to go back to stdout
+void dump_set_sink(dump_sink *sink, void *context);
+void dump_data_to(dump_sink *sink, void *context, const void *data, size_t size, const char *description);
 void dump_data(const void *data, size_t size, const char *description);
 void dump_string(const char *string, const char *description);
 void dump_big_number(mbedtls_mpi *big_number, const char *description);
 void dump_buffer(buffer_t buffer, const char *description);
+// Print a table of the statistics taken by utils_stats_snapshot
+void dump_stats(const utils_stats_t *stats, const char *description);
+
+// Counters of the asynchronous mode, since it was started. They wrap around
+typedef struct {
+    // Dumps accepted into the queue
+    uint32_t queued;
+    // Dumps formatted and written to the sink
+    uint32_t written;
+    // Dumps lost because the queue was full
+    uint32_t dropped;
+    // Dumps refused by the rate limit
+    uint32_t rate_limited;
+    // Dumps longer than UTILS_DUMP_ASYNC_SLOT_SIZE
+    uint32_t truncated;
+} dump_async_stats_t;
+
+// Make dump_data, dump_string, dump_buffer and dump_big_number copy the bytes into a lock-free queue
+// and return at once, without blocking. A worker task formats them and writes them to the sink set
+// by dump_set_sink. dump_data_to and dump_stats still write synchronously
+int dump_async_start(void);
+// Write out what is queued and go back to synchronous dumps. No dump may be in progress meanwhile
+void dump_async_stop(void);
+bool dump_async_running(void);
+// Wait until the dumps queued so far are written out
+void dump_async_flush(void);
+void dump_async_get_stats(dump_async_stats_t *stats);
+// Accept at most count dumps with the same description per period_ms, rounded up to whole ticks.
+// Descriptions are told apart by a hash, so a few may end up sharing a budget. A count of 0
+// removes the limit
+int dump_async_set_rate_limit(int count, int period_ms);
 
 #endif
 #ifdef __cplusplus
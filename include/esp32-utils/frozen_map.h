@@ -0,0 +1,87 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _UTILS_FROZEN_MAP_H_
+#define _UTILS_FROZEN_MAP_H_
+
+#include "esp32-utils/utils.h"
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#endif
+
+typedef struct _map *map_t;
+typedef struct _buffer *buffer_t;
+
+/***********************************************************************************************************
+ * Frozen map
+ ***********************************************************************************************************/
+// Read-only map compiled into a blob that is used in place, from flash or from a mapped file,
+// without copying or allocating. Keys are placed with a minimal perfect hash, so a lookup hashes
+// the key once and compares it with a single entry. The blob holds only offsets and little endian
+// integers, it can be stored anywhere and loaded on any platform.
+// The fields are private, the structure is the caller's so that lookups need no heap
+typedef struct {
+    const unsigned char *data;
+    int size;
+    uint32_t count;
+    uint32_t buckets;
+    uint32_t seed;
+    // How the loaders mapped the blob, if they did
+    bool mapped;
+    uint32_t handle;
+} frozen_map_t;
+
+// Append the blob for map to out. Values must be buffers, keys and values are copied
+int frozen_map_freeze(map_t map, buffer_t out);
+// Use the blob at data, which must stay valid and unchanged. size can be more than the blob.
+// Return UTILS_ERR_INVALID_DATA if it isn't a blob made by frozen_map_freeze
+int frozen_map_open(frozen_map_t *map, const void *data, int size);
+#ifdef ESP_PLATFORM
+// Map the blob stored at the start of partition
+int frozen_map_open_partition(frozen_map_t *map, const esp_partition_t *partition);
+#else
+// Map the blob stored in the file at path
+int frozen_map_open_file(frozen_map_t *map, const char *path);
+#endif
+// Unmap what the loaders mapped
+void frozen_map_close(frozen_map_t *map);
+int frozen_map_count(const frozen_map_t *map);
+// Return the value for key and its length in len, or NULL. The value points into the blob
+const unsigned char *frozen_map_value_for_key(const frozen_map_t *map, const char *key, int *len);
+// Entries in storage order, for index from 0 to frozen_map_count - 1. Return the key, or NULL
+const char *frozen_map_entry_at(const frozen_map_t *map, int index, const unsigned char **value, int *len);
+
+#endif
+#ifdef __cplusplus
+}
+#endif
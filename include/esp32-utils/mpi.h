@@ -35,11 +35,27 @@ extern "C" {
 
 #include "esp32-utils/utils.h"
 
+typedef struct _utils_arena *utils_arena_t;
+
 #define UTILS_DECLARE_MPI(variable) \
     mbedtls_mpi *variable=NULL;
 
+// Set up a pool of count MPIs with limbs reserved for bits-bit values. utils_mpi_new takes
+// from the pool while it isn't empty, and utils_mpi_free clears pooled MPIs and gives them back.
+// mbedtls only reallocates the limbs of a pooled MPI if a value outgrows them
+int utils_mpi_pool_init(int count, size_t bits);
+// Fails with UTILS_ERR_IN_USE while pooled MPIs are still out
+int utils_mpi_pool_deinit(void);
+int utils_mpi_pool_available(void);
 mbedtls_mpi *utils_mpi_new(void);
+// The limbs are still allocated by mbedtls, they are freed when the arena is reset. MPIs from an
+// arena are released with utils_mpi_release, or left to the reset
+mbedtls_mpi *utils_mpi_new_in(utils_arena_t arena);
+// For pooled MPIs and any MPI allocated on the heap, such as by utils_mpi_new or
+// utils_mpi_new_in(NULL). Pooled MPIs are recognized by their address and given back
 void utils_mpi_free(void *mpi);
+// Free the limbs of an MPI from utils_mpi_new_in(arena) early, its memory goes with the arena
+void utils_mpi_release(void *mpi);
 
 #endif
 #ifdef __cplusplus
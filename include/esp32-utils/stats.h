@@ -0,0 +1,97 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _UTILS_STATS_H_
+#define _UTILS_STATS_H_
+
+#include "esp32-utils/utils.h"
+
+typedef struct _utils_arena *utils_arena_t;
+
+// Heap usage of the collections and MPIs, only collected when built with UTILS_STATS defined.
+// Objects allocated in an arena aren't counted, the arena accounts for them
+typedef enum {
+    UTILS_STATS_ARRAY,
+    UTILS_STATS_MAP,
+    UTILS_STATS_BUFFER,
+    UTILS_STATS_MPI,
+    UTILS_STATS_KINDS
+} utils_stats_kind_t;
+
+// Lookups probing this many slots or more share the last bucket
+#define UTILS_STATS_PROBE_BUCKETS   8
+
+typedef struct {
+    // Live objects, and the heap they hold
+    int objects;
+    int bytes;
+    int peak_bytes;
+    // Allocations and reallocations made since the last reset
+    int allocs;
+    int reallocs;
+} utils_stats_counters_t;
+
+typedef struct _utils_stats {
+    utils_stats_counters_t kinds[UTILS_STATS_KINDS];
+    // Slots probed by map lookups, by probe length
+    int map_probes[UTILS_STATS_PROBE_BUCKETS];
+} utils_stats_t;
+
+// Copy the current statistics, fails with UTILS_ERR_NOT_SUPPORTED if they aren't collected
+int utils_stats_snapshot(utils_stats_t *stats);
+// Clear the allocation counts and the probe histogram, and bring peaks down to current usage
+void utils_stats_reset(void);
+const char *utils_stats_kind_name(utils_stats_kind_t kind);
+
+#ifdef UTILS_STATS
+void utils_stats_new(utils_stats_kind_t kind, utils_arena_t arena, int size);
+void utils_stats_delete(utils_stats_kind_t kind, utils_arena_t arena, int size);
+void utils_stats_resize(utils_stats_kind_t kind, utils_arena_t arena, int old_size, int new_size);
+void utils_stats_probe(int length);
+
+#define UTILS_STATS_NEW(kind, arena, size)                  utils_stats_new(kind, arena, size)
+#define UTILS_STATS_DELETE(kind, arena, size)               utils_stats_delete(kind, arena, size)
+#define UTILS_STATS_RESIZE(kind, arena, old_size, new_size) utils_stats_resize(kind, arena, old_size, new_size)
+#define UTILS_STATS_PROBE(length)                           utils_stats_probe(length)
+#else
+// Arguments aren't evaluated, so collecting costs nothing when disabled
+#define UTILS_STATS_NEW(kind, arena, size)                  ((void)0)
+#define UTILS_STATS_DELETE(kind, arena, size)               ((void)0)
+#define UTILS_STATS_RESIZE(kind, arena, old_size, new_size) ((void)0)
+#define UTILS_STATS_PROBE(length)                           ((void)0)
+#endif
+
+#endif
+#ifdef __cplusplus
+}
+#endif
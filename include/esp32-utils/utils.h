@@ -43,14 +43,24 @@ extern "C" {
 #define UTILS_ERR_ALLOC_FAILED              -0x1004
 #define UTILS_ERR_OUT_OF_MEMORY             UTILS_ERR_ALLOC_FAILED
 #define UTILS_ERR_BUFFER_TOO_SMALL          -0x1006
+#define UTILS_ERR_READ_ONLY                 -0x1008
+#define UTILS_ERR_INVALID_DATA              -0x100A
+#define UTILS_ERR_IN_USE                    -0x100C
+#define UTILS_ERR_NOT_SUPPORTED             -0x100E
+#define UTILS_ERR_OUT_OF_RANGE              -0x1010
 
 #include "freertos/FreeRTOS.h"
 #include <string.h>
 #include <mbedtls/bignum.h>
 #include "errno.h"
+#include "esp32-utils/arena.h"
 #include "esp32-utils/collections.h"
+#include "esp32-utils/vector.h"
 #include "esp32-utils/mpi.h"
+#include "esp32-utils/stats.h"
 #include "esp32-utils/dump.h"
+#include "esp32-utils/cbor.h"
+#include "esp32-utils/frozen_map.h"
 
 #endif
 #ifdef __cplusplus
@@ -0,0 +1,244 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _UTILS_VECTOR_H_
+#define _UTILS_VECTOR_H_
+
+#include "esp32-utils/utils.h"
+
+typedef struct _utils_arena *utils_arena_t;
+typedef int(element_compare)(const void *a, const void *b);
+
+/***********************************************************************************************************
+ * Vector
+ ***********************************************************************************************************/
+// Storage shared by all vector types, elements are handled as blocks of bytes
+typedef struct {
+    int count;
+    int capacity;
+    unsigned char *elements;
+    utils_arena_t arena;
+    // Alignment of the storage, 0 for what malloc gives
+    int alignment;
+} utils_vector_t;
+
+void *utils_vector_new(utils_arena_t arena, size_t header_size, int alignment);
+void utils_vector_free(utils_vector_t *vector, size_t header_size, size_t element_size);
+int utils_vector_set_capacity(utils_vector_t *vector, size_t element_size, int capacity);
+int utils_vector_ensure_capacity(utils_vector_t *vector, size_t element_size, int count);
+// Open a gap of count elements at index, or close it
+int utils_vector_insert(utils_vector_t *vector, size_t element_size, int index, int count);
+int utils_vector_erase(utils_vector_t *vector, size_t element_size, int index, int count);
+// The comparison gets pointers to the elements
+void utils_vector_sort(utils_vector_t *vector, size_t element_size, element_compare *compare);
+int utils_vector_lower_bound(utils_vector_t *vector, size_t element_size, const void *element, element_compare *compare, bool upper);
+
+// Declare name##_t, a vector of type stored by value in one contiguous block, with the same
+// operations as array_t. Elements are passed and returned by value, or by pointer for lookups.
+// Pointers to elements are only valid until the vector is changed
+#define UTILS_DECLARE_VECTOR(name, type)                UTILS_DECLARE_ALIGNED_VECTOR(name, type, 0)
+
+// Same as above, with the storage aligned on alignment bytes, a power of two
+#define UTILS_DECLARE_ALIGNED_VECTOR(name, type, alignment)                                             \
+typedef void(name##_element_free)(type *element);                                                       \
+typedef bool(name##_element_predicate)(const type *element, void *context);                             \
+typedef struct _##name {                                                                                \
+    utils_vector_t vector;                                                                              \
+    name##_element_free *free_callback;                                                                 \
+} *name##_t;                                                                                            \
+                                                                                                        \
+static inline name##_t name##_new_in(utils_arena_t arena, name##_element_free *free_callback) {         \
+    name##_t v = (name##_t)utils_vector_new(arena, sizeof(struct _##name), alignment);                  \
+    if (v) {                                                                                            \
+        v->free_callback = free_callback;                                                               \
+    }                                                                                                   \
+    return v;                                                                                           \
+}                                                                                                       \
+static inline name##_t name##_new(name##_element_free *free_callback) {                                 \
+    return name##_new_in(NULL, free_callback);                                                          \
+}                                                                                                       \
+static inline void name##_clear(name##_t v) {                                                           \
+    if (v->free_callback) {                                                                             \
+        for (int i = 0; i < v->vector.count; i++) {                                                     \
+            v->free_callback((type *)v->vector.elements + i);                                           \
+        }                                                                                               \
+    }                                                                                                   \
+    v->vector.count = 0;                                                                                \
+}                                                                                                       \
+static inline void name##_free(void *p) {                                                               \
+    name##_t v = (name##_t)p;                                                                           \
+    if (v) {                                                                                            \
+        name##_clear(v);                                                                                \
+        utils_vector_free(&v->vector, sizeof(struct _##name), sizeof(type));                            \
+    }                                                                                                   \
+}                                                                                                       \
+static inline int name##_count(name##_t v) {                                                            \
+    return v->vector.count;                                                                             \
+}                                                                                                       \
+static inline int name##_capacity(name##_t v) {                                                         \
+    return v->vector.capacity;                                                                          \
+}                                                                                                       \
+static inline int name##_reserve(name##_t v, int capacity) {                                            \
+    if (capacity <= v->vector.capacity) {                                                               \
+        return UTILS_ERR_OK;                                                                            \
+    }                                                                                                   \
+    return utils_vector_set_capacity(&v->vector, sizeof(type), capacity);                               \
+}                                                                                                       \
+static inline int name##_shrink_to_fit(name##_t v) {                                                    \
+    return utils_vector_set_capacity(&v->vector, sizeof(type), v->vector.count);                        \
+}                                                                                                       \
+/* The elements, contiguous */                                                                          \
+static inline type *name##_data(name##_t v) {                                                           \
+    return (type *)v->vector.elements;                                                                  \
+}                                                                                                       \
+static inline type *name##_at(name##_t v, int index) {                                                  \
+    if (index < 0 || index >= v->vector.count) {                                                        \
+        return NULL;                                                                                    \
+    }                                                                                                   \
+    return (type *)v->vector.elements + index;                                                          \
+}                                                                                                       \
+static inline int name##_push(name##_t v, type element) {                                               \
+    if (v->vector.count == v->vector.capacity &&                                                        \
+        utils_vector_ensure_capacity(&v->vector, sizeof(type), v->vector.count + 1)) {                  \
+        return UTILS_ERR_ALLOC_FAILED;                                                                  \
+    }                                                                                                   \
+    ((type *)v->vector.elements)[v->vector.count++] = element;                                          \
+    return UTILS_ERR_OK;                                                                                \
+}                                                                                                       \
+/* Copy the last element to element, if not NULL, and remove it. false if empty */                      \
+static inline bool name##_pop(name##_t v, type *element) {                                              \
+    if (!v->vector.count) {                                                                             \
+        return false;                                                                                   \
+    }                                                                                                   \
+    v->vector.count--;                                                                                  \
+    if (element) {                                                                                      \
+        *element = ((type *)v->vector.elements)[v->vector.count];                                       \
+    }                                                                                                   \
+    return true;                                                                                        \
+}                                                                                                       \
+static inline bool name##_remove_at(name##_t v, int index, type *element) {                             \
+    type *at = name##_at(v, index);                                                                     \
+    if (!at) {                                                                                          \
+        return false;                                                                                   \
+    }                                                                                                   \
+    if (element) {                                                                                      \
+        *element = *at;                                                                                 \
+    }                                                                                                   \
+    utils_vector_erase(&v->vector, sizeof(type), index, 1);                                             \
+    return true;                                                                                        \
+}                                                                                                       \
+/* Store element at index, copying what was there to old if not NULL */                                 \
+static inline bool name##_replace(name##_t v, int index, type element, type *old) {                     \
+    type *at = name##_at(v, index);                                                                     \
+    if (!at) {                                                                                          \
+        return false;                                                                                   \
+    }                                                                                                   \
+    if (old) {                                                                                          \
+        *old = *at;                                                                                     \
+    }                                                                                                   \
+    *at = element;                                                                                      \
+    return true;                                                                                        \
+}                                                                                                       \
+static inline int name##_insert_at(name##_t v, int index, type element) {                               \
+    int ret;                                                                                            \
+    if ((ret = utils_vector_insert(&v->vector, sizeof(type), index, 1))) {                              \
+        return ret;                                                                                     \
+    }                                                                                                   \
+    ((type *)v->vector.elements)[index] = element;                                                      \
+    return UTILS_ERR_OK;                                                                                \
+}                                                                                                       \
+static inline int name##_push_many(name##_t v, const type *elements, int count) {                       \
+    int ret;                                                                                            \
+    if ((ret = utils_vector_insert(&v->vector, sizeof(type), v->vector.count, count))) {                \
+        return ret;                                                                                     \
+    }                                                                                                   \
+    if (!count) {                                                                                       \
+        return UTILS_ERR_OK;                                                                            \
+    }                                                                                                   \
+    memcpy((type *)v->vector.elements + v->vector.count - count, elements, sizeof(type) * count);       \
+    return UTILS_ERR_OK;                                                                                \
+}                                                                                                       \
+static inline int name##_remove_range(name##_t v, int index, int count) {                               \
+    if (index < 0 || count < 0 || count > v->vector.count - index) {                                    \
+        return UTILS_ERR_OUT_OF_RANGE;                                                                  \
+    }                                                                                                   \
+    if (v->free_callback) {                                                                             \
+        for (int i = index; i < index + count; i++) {                                                   \
+            v->free_callback((type *)v->vector.elements + i);                                           \
+        }                                                                                               \
+    }                                                                                                   \
+    return utils_vector_erase(&v->vector, sizeof(type), index, count);                                  \
+}                                                                                                       \
+static inline int name##_remove_if(name##_t v, name##_element_predicate *predicate, void *context) {    \
+    type *elements = (type *)v->vector.elements;                                                        \
+    int kept = 0;                                                                                       \
+    for (int i = 0; i < v->vector.count; i++) {                                                         \
+        if (predicate(&elements[i], context)) {                                                         \
+            if (v->free_callback) {                                                                     \
+                v->free_callback(&elements[i]);                                                         \
+            }                                                                                           \
+        }                                                                                               \
+        else {                                                                                          \
+            elements[kept++] = elements[i];                                                             \
+        }                                                                                               \
+    }                                                                                                   \
+    int removed = v->vector.count - kept;                                                               \
+    v->vector.count = kept;                                                                             \
+    return removed;                                                                                     \
+}                                                                                                       \
+static inline void name##_sort(name##_t v, element_compare *compare) {                                  \
+    utils_vector_sort(&v->vector, sizeof(type), compare);                                               \
+}                                                                                                       \
+static inline int name##_lower_bound(name##_t v, const type *element, element_compare *compare) {       \
+    return utils_vector_lower_bound(&v->vector, sizeof(type), element, compare, false);                 \
+}                                                                                                       \
+static inline int name##_bsearch(name##_t v, const type *element, element_compare *compare) {           \
+    int index = name##_lower_bound(v, element, compare);                                                \
+    if (index < v->vector.count && !compare((type *)v->vector.elements + index, element)) {             \
+        return index;                                                                                   \
+    }                                                                                                   \
+    return -1;                                                                                          \
+}                                                                                                       \
+static inline int name##_insert_sorted(name##_t v, type element, element_compare *compare) {            \
+    int index = utils_vector_lower_bound(&v->vector, sizeof(type), &element, compare, true);            \
+    int ret;                                                                                            \
+    if ((ret = name##_insert_at(v, index, element))) {                                                  \
+        return ret;                                                                                     \
+    }                                                                                                   \
+    return index;                                                                                       \
+}
+
+#endif
+#ifdef __cplusplus
+}
+#endif
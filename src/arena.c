@@ -0,0 +1,196 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include "esp32-utils/arena.h"
+
+#define ARENA_ALIGNMENT             8
+#define ARENA_ALIGN(size)           (((size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+struct _utils_arena_chunk {
+    struct _utils_arena_chunk *next;
+    size_t size;
+    size_t used;
+    // Keeps data aligned
+    size_t padding;
+    unsigned char data[];
+};
+
+struct _utils_arena_cleanup {
+    utils_arena_cleanup *cleanup;
+    void *data;
+    struct _utils_arena_cleanup *next;
+};
+
+struct _utils_arena {
+    // Chunk being allocated from, followed by the older ones. The first chunk is the last one
+    struct _utils_arena_chunk *chunks;
+    size_t chunk_size;
+    // Last block allocated, which can grow or be released in place
+    unsigned char *last;
+    struct _utils_arena_cleanup *cleanups;
+};
+
+static struct _utils_arena_chunk *utils_arena_chunk_new(size_t size) {
+    struct _utils_arena_chunk *chunk;
+    if (!(chunk = (struct _utils_arena_chunk *)malloc(sizeof(struct _utils_arena_chunk) + size))) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+utils_arena_t utils_arena_new(size_t chunk_size) {
+    utils_arena_t arena;
+    if (!(arena = (utils_arena_t)malloc(sizeof(struct _utils_arena)))) {
+        goto cleanup;
+    }
+    memset(arena, 0, sizeof(struct _utils_arena));
+    arena->chunk_size = ARENA_ALIGN(chunk_size);
+    if (!(arena->chunks = utils_arena_chunk_new(arena->chunk_size))) {
+        goto cleanup;
+    }
+    return arena;
+cleanup:
+    free(arena);
+    errno = UTILS_ERR_ALLOC_FAILED;
+    return NULL;
+}
+
+void utils_arena_free(void *a) {
+    utils_arena_t arena = (utils_arena_t)a;
+    if (arena) {
+        utils_arena_reset(arena);
+        free(arena->chunks);
+        free(a);
+    }
+}
+
+void utils_arena_reset(utils_arena_t arena) {
+    while (arena->cleanups) {
+        struct _utils_arena_cleanup *cleanup = arena->cleanups;
+        arena->cleanups = cleanup->next;
+        cleanup->cleanup(cleanup->data);
+    }
+    // Keep the first chunk only
+    while (arena->chunks->next) {
+        struct _utils_arena_chunk *chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        free(chunk);
+    }
+    arena->chunks->used = 0;
+    arena->last = NULL;
+}
+
+size_t utils_arena_used(utils_arena_t arena) {
+    size_t used = 0;
+    for (struct _utils_arena_chunk *chunk = arena->chunks; chunk; chunk = chunk->next) {
+        used += chunk->used;
+    }
+    return used;
+}
+
+void *utils_arena_malloc(utils_arena_t arena, size_t size) {
+    if (!arena) {
+        return malloc(size);
+    }
+    struct _utils_arena_chunk *chunk = arena->chunks;
+    size = ARENA_ALIGN(size);
+    if (chunk->size - chunk->used < size) {
+        size_t chunk_size = (size > arena->chunk_size) ? size : arena->chunk_size;
+        if (!(chunk = utils_arena_chunk_new(chunk_size))) {
+            return NULL;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+    arena->last = chunk->data + chunk->used;
+    chunk->used += size;
+    return arena->last;
+}
+
+void *utils_arena_realloc(utils_arena_t arena, void *ptr, size_t old_size, size_t size) {
+    if (!arena) {
+        return realloc(ptr, size);
+    }
+    if (!ptr) {
+        return utils_arena_malloc(arena, size);
+    }
+    struct _utils_arena_chunk *chunk = arena->chunks;
+    if (ptr == arena->last) {
+        size_t offset = arena->last - chunk->data;
+        if (chunk->size - offset >= ARENA_ALIGN(size)) {
+            chunk->used = offset + ARENA_ALIGN(size);
+            return ptr;
+        }
+    }
+    void *new_ptr;
+    if ((new_ptr = utils_arena_malloc(arena, size))) {
+        memcpy(new_ptr, ptr, (old_size < size) ? old_size : size);
+    }
+    return new_ptr;
+}
+
+void utils_arena_release(utils_arena_t arena, void *ptr, size_t size) {
+    if (!arena) {
+        free(ptr);
+    }
+    else if (ptr) {
+        // Roll back the block if it is the top of the current chunk, so that blocks released in
+        // the reverse order of their allocation are all given back
+        struct _utils_arena_chunk *chunk = arena->chunks;
+        unsigned char *block = (unsigned char *)ptr;
+        if (block >= chunk->data && block + ARENA_ALIGN(size) == chunk->data + chunk->used) {
+            chunk->used = block - chunk->data;
+            arena->last = NULL;
+        }
+    }
+}
+
+char *utils_arena_strdup(utils_arena_t arena, const char *string) {
+    char *copy;
+    size_t size = strlen(string) + 1;
+    if ((copy = (char *)utils_arena_malloc(arena, size))) {
+        memcpy(copy, string, size);
+    }
+    return copy;
+}
+
+int utils_arena_add_cleanup(utils_arena_t arena, utils_arena_cleanup *cleanup, void *data) {
+    struct _utils_arena_cleanup *entry;
+    if (!(entry = (struct _utils_arena_cleanup *)utils_arena_malloc(arena, sizeof(struct _utils_arena_cleanup)))) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    entry->cleanup = cleanup;
+    entry->data = data;
+    entry->next = arena->cleanups;
+    arena->cleanups = entry;
+    return UTILS_ERR_OK;
+}
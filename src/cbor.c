@@ -0,0 +1,574 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include "esp32-utils/cbor.h"
+#include <stdlib.h>
+
+#define CBOR_MAJOR_UINT             0
+#define CBOR_MAJOR_BYTES            2
+#define CBOR_MAJOR_TEXT             3
+#define CBOR_MAJOR_ARRAY            4
+#define CBOR_MAJOR_MAP              5
+#define CBOR_MAJOR_TAG              6
+#define CBOR_MAJOR_SIMPLE           7
+#define CBOR_TAG_BIGNUM             2
+#define CBOR_SIMPLE_NULL            22
+// Map keys up to this size are \0 terminated on the stack when decoding
+#define CBOR_KEY_SIZE               64
+
+/***********************************************************************************************************
+ * Types
+ ***********************************************************************************************************/
+void cbor_uint_free(void *element) {
+}
+
+int cbor_type_for_free_callback(element_free *free_callback, cbor_type_t *type) {
+    if (!free_callback) {
+        *type = CBOR_TYPE_NULL;
+    }
+    else if (free_callback == cbor_uint_free) {
+        *type = CBOR_TYPE_UINT;
+    }
+    else if (free_callback == free) {
+        *type = CBOR_TYPE_STRING;
+    }
+    else if (free_callback == buffer_free) {
+        *type = CBOR_TYPE_BUFFER;
+    }
+    else if (free_callback == utils_mpi_free || free_callback == utils_mpi_release) {
+        *type = CBOR_TYPE_MPI;
+    }
+    else if (free_callback == array_free) {
+        *type = CBOR_TYPE_ARRAY;
+    }
+    else if (free_callback == map_free) {
+        *type = CBOR_TYPE_MAP;
+    }
+    else {
+        return UTILS_ERR_NOT_SUPPORTED;
+    }
+    return UTILS_ERR_OK;
+}
+
+element_free *cbor_free_callback_for_type(cbor_type_t type) {
+    switch (type) {
+        case CBOR_TYPE_UINT:
+            return cbor_uint_free;
+        case CBOR_TYPE_STRING:
+            return free;
+        case CBOR_TYPE_BUFFER:
+            return buffer_free;
+        case CBOR_TYPE_MPI:
+            return utils_mpi_free;
+        case CBOR_TYPE_ARRAY:
+            return array_free;
+        case CBOR_TYPE_MAP:
+            return map_free;
+        default:
+            return NULL;
+    }
+}
+
+static void cbor_free_value(cbor_type_t type, void *value) {
+    element_free *free_callback = cbor_free_callback_for_type(type);
+    if (free_callback && value) {
+        free_callback(value);
+    }
+}
+
+/***********************************************************************************************************
+ * Encoder
+ ***********************************************************************************************************/
+// Major type and argument, on the fewest bytes
+static int cbor_append_head(buffer_t buffer, int major, uint64_t value) {
+    unsigned char head[9];
+    int len;
+    if (value < 24) {
+        head[0] = (major << 5) | (int)value;
+        return buffer_append(buffer, head, 1);
+    }
+    else if (value <= 0xff) {
+        head[0] = (major << 5) | 24;
+        len = 2;
+    }
+    else if (value <= 0xffff) {
+        head[0] = (major << 5) | 25;
+        len = 3;
+    }
+    else if (value <= 0xffffffff) {
+        head[0] = (major << 5) | 26;
+        len = 5;
+    }
+    else {
+        head[0] = (major << 5) | 27;
+        len = 9;
+    }
+    for (int i = len - 1; i > 0; i--, value >>= 8) {
+        head[i] = (unsigned char)value;
+    }
+    return buffer_append(buffer, head, len);
+}
+
+static int cbor_append_value(buffer_t buffer, cbor_type_t type, void *value, int depth);
+
+static int cbor_append_elements(buffer_t buffer, array_t array, int depth) {
+    cbor_type_t type;
+    int ret;
+    if ((ret = cbor_type_for_free_callback(array_get_free_callback(array), &type))) {
+        return ret;
+    }
+    for (int i = 0; i < array_count(array); i++) {
+        if ((ret = cbor_append_value(buffer, type, array_at(array, i), depth))) {
+            return ret;
+        }
+    }
+    return UTILS_ERR_OK;
+}
+
+// Entries are read through an iterator, which leaves the map as it is
+static int cbor_append_entries(buffer_t buffer, map_t map, int depth) {
+    map_iterator_t iterator;
+    cbor_type_t type;
+    int ret;
+    if ((ret = cbor_type_for_free_callback(map_get_free_callback(map), &type))) {
+        return ret;
+    }
+    map_iterator_init(&iterator, map);
+    while (map_iterator_next(&iterator)) {
+        int len = strlen(iterator.key);
+        if ((ret = cbor_append_head(buffer, CBOR_MAJOR_TEXT, len)) ||
+            (ret = buffer_append(buffer, (const unsigned char *)iterator.key, len)) ||
+            (ret = cbor_append_value(buffer, type, iterator.value, depth))) {
+            return ret;
+        }
+    }
+    return UTILS_ERR_OK;
+}
+
+static int cbor_append_value(buffer_t buffer, cbor_type_t type, void *value, int depth) {
+    int ret;
+    if (!value && type != CBOR_TYPE_UINT) {
+        type = CBOR_TYPE_NULL;
+    }
+    switch (type) {
+        case CBOR_TYPE_UINT:
+            return cbor_append_head(buffer, CBOR_MAJOR_UINT, (uintptr_t)value);
+        case CBOR_TYPE_STRING: {
+            int len = strlen((const char *)value);
+            if ((ret = cbor_append_head(buffer, CBOR_MAJOR_TEXT, len))) {
+                return ret;
+            }
+            return buffer_append(buffer, (const unsigned char *)value, len);
+        }
+        case CBOR_TYPE_BUFFER:
+            if ((ret = cbor_append_head(buffer, CBOR_MAJOR_BYTES, buffer_get_length((buffer_t)value)))) {
+                return ret;
+            }
+            return buffer_append_buffer(buffer, (buffer_t)value);
+        case CBOR_TYPE_MPI:
+            // Only positive bignums are written, a negative number would come back positive
+            if (mbedtls_mpi_cmp_int((mbedtls_mpi *)value, 0) < 0) {
+                return UTILS_ERR_NOT_SUPPORTED;
+            }
+            if ((ret = cbor_append_head(buffer, CBOR_MAJOR_TAG, CBOR_TAG_BIGNUM)) ||
+                (ret = cbor_append_head(buffer, CBOR_MAJOR_BYTES, mbedtls_mpi_size((mbedtls_mpi *)value)))) {
+                return ret;
+            }
+            return buffer_append_mpi(buffer, (mbedtls_mpi *)value);
+        case CBOR_TYPE_ARRAY:
+            if (depth >= CBOR_MAX_DEPTH) {
+                return UTILS_ERR_NOT_SUPPORTED;
+            }
+            if ((ret = cbor_append_head(buffer, CBOR_MAJOR_ARRAY, array_count((array_t)value)))) {
+                return ret;
+            }
+            return cbor_append_elements(buffer, (array_t)value, depth + 1);
+        case CBOR_TYPE_MAP:
+            if (depth >= CBOR_MAX_DEPTH) {
+                return UTILS_ERR_NOT_SUPPORTED;
+            }
+            if ((ret = cbor_append_head(buffer, CBOR_MAJOR_MAP, map_count((map_t)value)))) {
+                return ret;
+            }
+            return cbor_append_entries(buffer, (map_t)value, depth + 1);
+        case CBOR_TYPE_NULL:
+            // An element of a container without a free callback, which can't be typed
+            if (value) {
+                return UTILS_ERR_NOT_SUPPORTED;
+            }
+            return cbor_append_head(buffer, CBOR_MAJOR_SIMPLE, CBOR_SIMPLE_NULL);
+        default:
+            return UTILS_ERR_NOT_SUPPORTED;
+    }
+}
+
+int cbor_append(buffer_t buffer, cbor_type_t type, void *value) {
+    int len = buffer_get_length(buffer);
+    int ret;
+    if ((ret = cbor_append_value(buffer, type, value, 0))) {
+        buffer_truncate(buffer, len);
+    }
+    return ret;
+}
+
+int cbor_append_array(buffer_t buffer, array_t array) {
+    return cbor_append(buffer, CBOR_TYPE_ARRAY, array);
+}
+
+int cbor_append_map(buffer_t buffer, map_t map) {
+    return cbor_append(buffer, CBOR_TYPE_MAP, map);
+}
+
+/***********************************************************************************************************
+ * Decoder
+ ***********************************************************************************************************/
+typedef struct {
+    const unsigned char *data;
+    const unsigned char *end;
+} cbor_reader_t;
+
+static int cbor_read_head(cbor_reader_t *reader, int *major, uint64_t *value) {
+    if (reader->data == reader->end) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    int initial = *reader->data++;
+    int info = initial & 0x1f;
+    *major = initial >> 5;
+    if (info < 24) {
+        *value = info;
+        return UTILS_ERR_OK;
+    }
+    // Indefinite lengths are never written
+    if (info > 27) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    int len = 1 << (info - 24);
+    if (reader->end - reader->data < len) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    uint64_t argument = 0;
+    for (int i = 0; i < len; i++) {
+        argument = (argument << 8) | *reader->data++;
+    }
+    *value = argument;
+    return UTILS_ERR_OK;
+}
+
+// Read one item, and the payload of strings, buffers and MPIs. Counts of containers are checked
+// against what is left, so that a corrupted count can't make the decoder allocate much
+static int cbor_read_item(cbor_reader_t *reader, cbor_item_t *item) {
+    int major;
+    int ret;
+    if ((ret = cbor_read_head(reader, &major, &item->value))) {
+        return ret;
+    }
+    uint64_t left = reader->end - reader->data;
+    item->data = NULL;
+    item->length = 0;
+    switch (major) {
+        case CBOR_MAJOR_UINT:
+            item->type = CBOR_TYPE_UINT;
+            return UTILS_ERR_OK;
+        case CBOR_MAJOR_TAG:
+            if (item->value != CBOR_TAG_BIGNUM ||
+                cbor_read_head(reader, &major, &item->value) || major != CBOR_MAJOR_BYTES) {
+                return UTILS_ERR_INVALID_DATA;
+            }
+            item->type = CBOR_TYPE_MPI;
+            left = reader->end - reader->data;
+            break;
+        case CBOR_MAJOR_BYTES:
+            item->type = CBOR_TYPE_BUFFER;
+            break;
+        case CBOR_MAJOR_TEXT:
+            item->type = CBOR_TYPE_STRING;
+            // Strings are \0 terminated once decoded, so they can't hold one
+            if (item->value <= left && memchr(reader->data, 0, (size_t)item->value)) {
+                return UTILS_ERR_INVALID_DATA;
+            }
+            break;
+        case CBOR_MAJOR_ARRAY:
+            item->type = CBOR_TYPE_ARRAY;
+            return item->value <= left ? UTILS_ERR_OK : UTILS_ERR_INVALID_DATA;
+        case CBOR_MAJOR_MAP:
+            item->type = CBOR_TYPE_MAP;
+            return item->value <= left / 2 ? UTILS_ERR_OK : UTILS_ERR_INVALID_DATA;
+        case CBOR_MAJOR_SIMPLE:
+            item->type = CBOR_TYPE_NULL;
+            return item->value == CBOR_SIMPLE_NULL ? UTILS_ERR_OK : UTILS_ERR_INVALID_DATA;
+        default:
+            return UTILS_ERR_INVALID_DATA;
+    }
+    if (item->value > left) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    item->data = reader->data;
+    item->length = (int)item->value;
+    reader->data += item->length;
+    return UTILS_ERR_OK;
+}
+
+static int cbor_read_key(cbor_reader_t *reader, cbor_item_t *key) {
+    int ret;
+    if ((ret = cbor_read_item(reader, key))) {
+        return ret;
+    }
+    return key->type == CBOR_TYPE_STRING ? UTILS_ERR_OK : UTILS_ERR_INVALID_DATA;
+}
+
+// Type of the first non null element, or map value, of a container
+static int cbor_peek_type(cbor_reader_t reader, uint64_t count, bool map, cbor_type_t *type) {
+    cbor_item_t item;
+    int ret;
+    for (uint64_t i = 0; i < count; i++) {
+        if ((map && (ret = cbor_read_key(&reader, &item))) || (ret = cbor_read_item(&reader, &item))) {
+            return ret;
+        }
+        if (item.type != CBOR_TYPE_NULL) {
+            *type = item.type;
+            return UTILS_ERR_OK;
+        }
+    }
+    *type = CBOR_TYPE_NULL;
+    return UTILS_ERR_OK;
+}
+
+static int cbor_decode_value(cbor_reader_t *reader, int depth, cbor_type_t *type, void **value);
+
+// Decode the next value, which must be of type or null
+static int cbor_decode_element(cbor_reader_t *reader, int depth, cbor_type_t type, void **value) {
+    cbor_type_t element_type;
+    int ret;
+    if ((ret = cbor_decode_value(reader, depth, &element_type, value))) {
+        return ret;
+    }
+    if (element_type != type && element_type != CBOR_TYPE_NULL) {
+        cbor_free_value(element_type, *value);
+        return UTILS_ERR_INVALID_DATA;
+    }
+    return UTILS_ERR_OK;
+}
+
+static int cbor_decode_array(cbor_reader_t *reader, int depth, int count, void **value) {
+    cbor_type_t type;
+    array_t array = NULL;
+    int ret;
+    if ((ret = cbor_peek_type(*reader, count, false, &type))) {
+        return ret;
+    }
+    if (!(array = array_new(cbor_free_callback_for_type(type))) || array_reserve(array, count)) {
+        ret = UTILS_ERR_ALLOC_FAILED;
+        goto cleanup;
+    }
+    for (int i = 0; i < count; i++) {
+        void *element;
+        if ((ret = cbor_decode_element(reader, depth, type, &element))) {
+            goto cleanup;
+        }
+        array_push(array, element);
+    }
+    *value = array;
+    return UTILS_ERR_OK;
+cleanup:
+    array_free(array);
+    return ret;
+}
+
+static int cbor_decode_map(cbor_reader_t *reader, int depth, int count, void **value) {
+    char key_data[CBOR_KEY_SIZE];
+    char *key = key_data;
+    cbor_type_t type;
+    map_t map = NULL;
+    int ret;
+    if ((ret = cbor_peek_type(*reader, count, true, &type))) {
+        return ret;
+    }
+    if (!(map = map_new(cbor_free_callback_for_type(type)))) {
+        ret = UTILS_ERR_ALLOC_FAILED;
+        goto cleanup;
+    }
+    for (int i = 0; i < count; i++) {
+        cbor_item_t item;
+        void *element;
+        if ((ret = cbor_read_key(reader, &item))) {
+            goto cleanup;
+        }
+        if (item.length >= CBOR_KEY_SIZE && !(key = (char *)malloc(item.length + 1))) {
+            ret = UTILS_ERR_ALLOC_FAILED;
+            goto cleanup;
+        }
+        memcpy(key, item.data, item.length);
+        key[item.length] = 0;
+        if ((ret = cbor_decode_element(reader, depth, type, &element))) {
+            goto cleanup;
+        }
+        if ((ret = map_insert(map, key, element))) {
+            // A key twice isn't valid
+            cbor_free_value(type, element);
+            if (ret == UTILS_ERR_IN_USE) {
+                ret = UTILS_ERR_INVALID_DATA;
+            }
+            goto cleanup;
+        }
+        if (key != key_data) {
+            free(key);
+            key = key_data;
+        }
+    }
+    *value = map;
+    return UTILS_ERR_OK;
+cleanup:
+    if (key != key_data) {
+        free(key);
+    }
+    map_free(map);
+    return ret;
+}
+
+static int cbor_decode_value(cbor_reader_t *reader, int depth, cbor_type_t *type, void **value) {
+    cbor_item_t item;
+    int ret;
+    if ((ret = cbor_read_item(reader, &item))) {
+        return ret;
+    }
+    *type = item.type;
+    *value = NULL;
+    switch (item.type) {
+        case CBOR_TYPE_UINT:
+            if (item.value > UINTPTR_MAX) {
+                return UTILS_ERR_INVALID_DATA;
+            }
+            *value = (void *)(uintptr_t)item.value;
+            return UTILS_ERR_OK;
+        case CBOR_TYPE_STRING: {
+            char *string;
+            if (!(string = (char *)malloc(item.length + 1))) {
+                return UTILS_ERR_ALLOC_FAILED;
+            }
+            memcpy(string, item.data, item.length);
+            string[item.length] = 0;
+            *value = string;
+            return UTILS_ERR_OK;
+        }
+        case CBOR_TYPE_BUFFER: {
+            buffer_t buffer;
+            if (!(buffer = buffer_new(item.length))) {
+                return UTILS_ERR_ALLOC_FAILED;
+            }
+            if ((ret = buffer_append(buffer, item.data, item.length))) {
+                buffer_free(buffer);
+                return ret;
+            }
+            *value = buffer;
+            return UTILS_ERR_OK;
+        }
+        case CBOR_TYPE_MPI: {
+            mbedtls_mpi *mpi;
+            if (!(mpi = utils_mpi_new())) {
+                return UTILS_ERR_ALLOC_FAILED;
+            }
+            if (mbedtls_mpi_read_binary(mpi, item.data, item.length)) {
+                utils_mpi_free(mpi);
+                return UTILS_ERR_ALLOC_FAILED;
+            }
+            *value = mpi;
+            return UTILS_ERR_OK;
+        }
+        case CBOR_TYPE_ARRAY:
+            if (depth >= CBOR_MAX_DEPTH) {
+                return UTILS_ERR_INVALID_DATA;
+            }
+            return cbor_decode_array(reader, depth + 1, (int)item.value, value);
+        case CBOR_TYPE_MAP:
+            if (depth >= CBOR_MAX_DEPTH) {
+                return UTILS_ERR_INVALID_DATA;
+            }
+            return cbor_decode_map(reader, depth + 1, (int)item.value, value);
+        default:
+            return UTILS_ERR_OK;
+    }
+}
+
+int cbor_decode(const unsigned char *data, int len, cbor_type_t *type, void **value) {
+    cbor_reader_t reader = { data, data + len };
+    int ret;
+    if ((ret = cbor_decode_value(&reader, 0, type, value))) {
+        return ret;
+    }
+    if (reader.data != reader.end) {
+        cbor_free_value(*type, *value);
+        return UTILS_ERR_INVALID_DATA;
+    }
+    return UTILS_ERR_OK;
+}
+
+/***********************************************************************************************************
+ * Visitor
+ ***********************************************************************************************************/
+static int cbor_visit_value(cbor_reader_t *reader, cbor_item_t *item, cbor_visitor *visitor, void *context) {
+    int ret;
+    if ((ret = cbor_read_item(reader, item)) || (ret = visitor(context, item))) {
+        return ret;
+    }
+    if (item->type != CBOR_TYPE_ARRAY && item->type != CBOR_TYPE_MAP) {
+        return UTILS_ERR_OK;
+    }
+    if (item->depth >= CBOR_MAX_DEPTH) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    bool map = item->type == CBOR_TYPE_MAP;
+    uint64_t count = item->value;
+    cbor_item_t child;
+    for (uint64_t i = 0; i < count; i++) {
+        child.key = NULL;
+        child.key_length = 0;
+        if (map) {
+            if ((ret = cbor_read_key(reader, &child))) {
+                return ret;
+            }
+            child.key = (const char *)child.data;
+            child.key_length = child.length;
+        }
+        child.depth = item->depth + 1;
+        if ((ret = cbor_visit_value(reader, &child, visitor, context))) {
+            return ret;
+        }
+    }
+    return UTILS_ERR_OK;
+}
+
+int cbor_visit(const unsigned char *data, int len, cbor_visitor *visitor, void *context) {
+    cbor_reader_t reader = { data, data + len };
+    cbor_item_t item = { .depth = 0, .key = NULL, .key_length = 0 };
+    int ret;
+    if ((ret = cbor_visit_value(&reader, &item, visitor, context))) {
+        return ret;
+    }
+    return reader.data == reader.end ? UTILS_ERR_OK : UTILS_ERR_INVALID_DATA;
+}
@@ -27,29 +27,91 @@
  */
 
 #include "esp32-utils/collections.h"
+#include <stdatomic.h>
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+
+// Data written by different cores is kept on separate cache lines
+#define COLLECTIONS_CACHE_LINE      64
 
 /***********************************************************************************************************
  * Array
  ***********************************************************************************************************/
+// Capacity grows by half of itself, which wastes less heap than doubling
+#define ARRAY_MIN_CAPACITY          4
+
 struct _array {
     int count;
+    int capacity;
     void **elements;
     element_free *free_callback;
+    utils_arena_t arena;
+#ifdef UTILS_STATS
+    // Arrays used inside maps are accounted to the map
+    utils_stats_kind_t stats_kind;
+#endif
 };
 
-array_t array_new(element_free *free_callback) {
+static int array_set_capacity(array_t array, int capacity) {
+    void **elements;
+    if (!capacity) {
+        utils_arena_release(array->arena, array->elements, sizeof(void *) * array->capacity);
+        array->elements = NULL;
+    }
+    else if ((elements = (void **)utils_arena_realloc(array->arena, array->elements,
+        sizeof(void *) * array->capacity, sizeof(void *) * capacity))) {
+        array->elements = elements;
+    }
+    else {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    UTILS_STATS_RESIZE(array->stats_kind, array->arena, sizeof(void *) * array->capacity, sizeof(void *) * capacity);
+    array->capacity = capacity;
+    return UTILS_ERR_OK;
+}
+
+// Make room for count elements, growing geometrically
+static int array_ensure_capacity(array_t array, int count) {
+    if (count <= array->capacity) {
+        return UTILS_ERR_OK;
+    }
+    int capacity = array->capacity + array->capacity / 2;
+    if (capacity < ARRAY_MIN_CAPACITY) {
+        capacity = ARRAY_MIN_CAPACITY;
+    }
+    if (capacity < count) {
+        capacity = count;
+    }
+    return array_set_capacity(array, capacity);
+}
+
+static array_t array_create(utils_arena_t arena, element_free *free_callback, utils_stats_kind_t stats_kind) {
     array_t array;
-    if (!(array = (array_t)malloc(sizeof(struct _array)))) {
+    if (!(array = (array_t)utils_arena_malloc(arena, sizeof(struct _array)))) {
         goto cleanup;
     }
     memset(array, 0, sizeof(struct _array));
     array->free_callback = free_callback;
+    array->arena = arena;
+#ifdef UTILS_STATS
+    array->stats_kind = stats_kind;
+#endif
+    UTILS_STATS_NEW(stats_kind, arena, sizeof(struct _array));
     return array;
 cleanup:
     errno = UTILS_ERR_ALLOC_FAILED;
     return NULL;
 }
 
+array_t array_new(element_free *free_callback) {
+    return array_new_in(NULL, free_callback);
+}
+
+array_t array_new_in(utils_arena_t arena, element_free *free_callback) {
+    return array_create(arena, free_callback, UTILS_STATS_ARRAY);
+}
+
 void array_free(void *a) {
     array_t array = (array_t)a;
     if (array) {
@@ -58,7 +120,9 @@ void array_free(void *a) {
                 array->free_callback(array->elements[i]);
             }
         }
-        free(a);
+        UTILS_STATS_DELETE(array->stats_kind, array->arena, sizeof(struct _array) + sizeof(void *) * array->capacity);
+        utils_arena_release(array->arena, array->elements, sizeof(void *) * array->capacity);
+        utils_arena_release(array->arena, a, sizeof(struct _array));
     }
 }
 
@@ -66,16 +130,31 @@ int array_count(array_t array) {
     return array->count;
 }
 
-int array_push(array_t array, void *element) {
-    if (!array->elements) {
-        if (!(array->elements = (void **)malloc(sizeof(void *)))) {
-            return UTILS_ERR_ALLOC_FAILED;
-        }
+int array_capacity(array_t array) {
+    return array->capacity;
+}
+
+element_free *array_get_free_callback(array_t array) {
+    return array->free_callback;
+}
+
+int array_reserve(array_t array, int capacity) {
+    if (capacity <= array->capacity) {
+        return UTILS_ERR_OK;
     }
-    else {
-        if (!(array->elements = (void **)realloc(array->elements, sizeof(void *) * (array->count + 1)))) {
-            return UTILS_ERR_ALLOC_FAILED;
-        }
+    return array_set_capacity(array, capacity);
+}
+
+int array_shrink_to_fit(array_t array) {
+    if (array->count == array->capacity) {
+        return UTILS_ERR_OK;
+    }
+    return array_set_capacity(array, array->count);
+}
+
+int array_push(array_t array, void *element) {
+    if (array_ensure_capacity(array, array->count + 1) != UTILS_ERR_OK) {
+        return UTILS_ERR_ALLOC_FAILED;
     }
     array->elements[array->count++] = element;
     return UTILS_ERR_OK;
@@ -86,19 +165,17 @@ void *array_pop(array_t array) {
 }
 
 void *array_remove_at(array_t array, int index) {
-    if (index < array->count) {
+    if (index >= 0 && index < array->count) {
         void *element = array->elements[index];
-        for (int i = index; i < array->count - 1; i++) {
-            array->elements[i] = array->elements[i + 1];
-        }
-        array->elements = (void **)realloc(array->elements, sizeof(void *) * (--array->count));
+        memmove(array->elements + index, array->elements + index + 1, sizeof(void *) * (array->count - index - 1));
+        array->count--;
         return element;
     }
     return NULL;
 }
 
 void *array_replace(array_t array, int index, void *element) {
-    if (index < array->count) {
+    if (index >= 0 && index < array->count) {
         void *old_element = array->elements[index];
         array->elements[index] = element;
         return old_element;
@@ -107,247 +184,2311 @@ void *array_replace(array_t array, int index, void *element) {
 }
 
 void *array_at(array_t array, int index) {
-    if (index < array->count) {
+    if (index >= 0 && index < array->count) {
         return array->elements[index];
     }
     return NULL;
 }
 
-/***********************************************************************************************************
- * Map
- ***********************************************************************************************************/
-struct _map {
-    array_t keys;
-    array_t values;
-};
+int array_insert_at(array_t array, int index, void *element) {
+    if (index < 0 || index > array->count) {
+        return UTILS_ERR_OUT_OF_RANGE;
+    }
+    if (array_ensure_capacity(array, array->count + 1) != UTILS_ERR_OK) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    memmove(array->elements + index + 1, array->elements + index, sizeof(void *) * (array->count - index));
+    array->elements[index] = element;
+    array->count++;
+    return UTILS_ERR_OK;
+}
 
-map_t map_new(element_free *free_callback) {
-    map_t map;
-    if (!(map = (map_t)malloc(sizeof(struct _map)))) {
-        goto cleanup;
+int array_push_many(array_t array, void * const *elements, int count) {
+    if (count < 0) {
+        return UTILS_ERR_OUT_OF_RANGE;
     }
-    memset(map, 0, sizeof(struct _map));
-    if (!(map->keys = array_new(free))) {
-        goto cleanup;
+    // Nothing to copy, elements may be NULL
+    if (!count) {
+        return UTILS_ERR_OK;
     }
-    if (!(map->values = array_new(free_callback))) {
-        goto cleanup;
+    if (array_ensure_capacity(array, array->count + count) != UTILS_ERR_OK) {
+        return UTILS_ERR_ALLOC_FAILED;
     }
-    return map;
-cleanup:
-    map_free(map);
-    errno = UTILS_ERR_ALLOC_FAILED;
-    return NULL;
+    memcpy(array->elements + array->count, elements, sizeof(void *) * count);
+    array->count += count;
+    return UTILS_ERR_OK;
 }
 
-void map_free(void *m) {
-    map_t map = (map_t)m;
-    if (map) {
-        array_free(map->keys);
-        array_free(map->values);
-        free(m);
+int array_remove_range(array_t array, int index, int count) {
+    if (index < 0 || count < 0 || count > array->count - index) {
+        return UTILS_ERR_OUT_OF_RANGE;
+    }
+    // An empty array may have no storage yet
+    if (!count) {
+        return UTILS_ERR_OK;
+    }
+    if (array->free_callback) {
+        for (int i = index; i < index + count; i++) {
+            array->free_callback(array->elements[i]);
+        }
     }
+    memmove(array->elements + index, array->elements + index + count, sizeof(void *) * (array->count - index - count));
+    array->count -= count;
+    return UTILS_ERR_OK;
 }
 
-int map_count(map_t map) {
-    return array_count(map->keys);
+int array_remove_if(array_t array, element_predicate *predicate, void *context) {
+    int kept = 0;
+    // Kept elements are compacted as the array is scanned
+    for (int i = 0; i < array->count; i++) {
+        void *element = array->elements[i];
+        if (predicate(element, context)) {
+            if (array->free_callback) {
+                array->free_callback(element);
+            }
+        }
+        else {
+            array->elements[kept++] = element;
+        }
+    }
+    int removed = array->count - kept;
+    array->count = kept;
+    return removed;
 }
 
-array_t map_keys(map_t map) {
-    return map->keys;
+void array_clear(array_t array) {
+    array_remove_range(array, 0, array->count);
 }
 
-array_t map_values(map_t map) {
-    return map->values;
+// Below this, partitions are finished with an insertion sort
+#define ARRAY_SORT_THRESHOLD        16
+
+static void array_swap(void **elements, int i, int j) {
+    void *element = elements[i];
+    elements[i] = elements[j];
+    elements[j] = element;
 }
 
-void *map_value_for_key(map_t map, const char *key) {
-    for (int i = 0; i < array_count(map->keys); i++) {
-        if (!strcmp(array_at(map->keys, i), key)) {
-            return array_at(map->values, i);
+static void array_insertion_sort(void **elements, int count, element_compare *compare) {
+    for (int i = 1; i < count; i++) {
+        void *element = elements[i];
+        int j = i;
+        for (; j > 0 && compare(elements[j - 1], element) > 0; j--) {
+            elements[j] = elements[j - 1];
         }
+        elements[j] = element;
     }
-    return NULL;
 }
 
-void *map_set_value_for_key(map_t map, const char *key, void *value) {
-    for (int i = 0; i < array_count(map->keys); i++) {
-        if (!strcmp(array_at(map->keys, i), key)) {
-            void *old_value = array_replace(map->values, i, value);
-            return old_value;
+static void array_sift_down(void **elements, int root, int count, element_compare *compare) {
+    for (int child; (child = root * 2 + 1) < count; root = child) {
+        if (child + 1 < count && compare(elements[child], elements[child + 1]) < 0) {
+            child++;
+        }
+        if (compare(elements[root], elements[child]) >= 0) {
+            return;
         }
+        array_swap(elements, root, child);
     }
-    array_push(map->keys, (void *)strdup(key));
-    array_push(map->values, value);
-    return value;
 }
 
-void *map_remove_value_for_key(map_t map, const char *key) {
-    for (int i = 0; i < array_count(map->keys); i++) {
-        if (!strcmp(array_at(map->keys, i), key)) {
-            free(array_remove_at(map->keys, i));
-            void *old_value = array_remove_at(map->values, i);
-            return old_value;
+static void array_heap_sort(void **elements, int count, element_compare *compare) {
+    for (int i = count / 2 - 1; i >= 0; i--) {
+        array_sift_down(elements, i, count, compare);
+    }
+    for (int i = count - 1; i > 0; i--) {
+        array_swap(elements, 0, i);
+        array_sift_down(elements, 0, i, compare);
+    }
+}
+
+// Quicksort that recurses into the smaller side only, so the stack stays within log2(count) frames,
+// and switches to heap sort when partitions keep coming out unbalanced
+static void array_intro_sort(void **elements, int count, int depth, element_compare *compare) {
+    while (count > ARRAY_SORT_THRESHOLD) {
+        if (!depth--) {
+            array_heap_sort(elements, count, compare);
+            return;
+        }
+        // Median of three as the pivot, moved to the front
+        int mid = count / 2;
+        int last = count - 1;
+        if (compare(elements[mid], elements[0]) < 0) {
+            array_swap(elements, mid, 0);
+        }
+        if (compare(elements[last], elements[mid]) < 0) {
+            array_swap(elements, last, mid);
+            if (compare(elements[mid], elements[0]) < 0) {
+                array_swap(elements, mid, 0);
+            }
+        }
+        array_swap(elements, 0, mid);
+        void *pivot = elements[0];
+        int i = 0;
+        int j = count;
+        for (;;) {
+            while (compare(elements[++i], pivot) < 0 && i < last) {
+            }
+            while (compare(pivot, elements[--j]) < 0) {
+            }
+            if (i >= j) {
+                break;
+            }
+            array_swap(elements, i, j);
+        }
+        array_swap(elements, 0, j);
+        if (j < count - j - 1) {
+            array_intro_sort(elements, j, depth, compare);
+            elements += j + 1;
+            count -= j + 1;
+        }
+        else {
+            array_intro_sort(elements + j + 1, count - j - 1, depth, compare);
+            count = j;
         }
     }
-    return NULL;
+    array_insertion_sort(elements, count, compare);
+}
+
+void array_sort(array_t array, element_compare *compare) {
+    int depth = 0;
+    for (int count = array->count; count > 1; count >>= 1) {
+        depth += 2;
+    }
+    array_intro_sort(array->elements, array->count, depth, compare);
+}
+
+int array_lower_bound(array_t array, const void *element, element_compare *compare) {
+    int low = 0;
+    int high = array->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (compare(array->elements[mid], element) < 0) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// First element greater than element, so that equal elements stay in insertion order
+static int array_upper_bound(array_t array, const void *element, element_compare *compare) {
+    int low = 0;
+    int high = array->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (compare(array->elements[mid], element) <= 0) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int array_bsearch(array_t array, const void *element, element_compare *compare) {
+    int index = array_lower_bound(array, element, compare);
+    if (index < array->count && !compare(array->elements[index], element)) {
+        return index;
+    }
+    return -1;
+}
+
+int array_insert_sorted(array_t array, void *element, element_compare *compare) {
+    int index = array_upper_bound(array, element, compare);
+    int ret;
+    if ((ret = array_insert_at(array, index, element)) != UTILS_ERR_OK) {
+        return ret;
+    }
+    return index;
 }
 
 /***********************************************************************************************************
- * Buffer
+ * Deque
  ***********************************************************************************************************/
-struct _buffer {
-    int size;
-    int pos;
-    unsigned char *data;
-    bool static_data;
+// Elements wrap around a power of two capacity, from head. Capacity doubles when full
+#define DEQUE_MIN_CAPACITY          4
+
+struct _deque {
+    int head;
+    int count;
+    int capacity;
+    void **elements;
+    element_free *free_callback;
+    utils_arena_t arena;
 };
 
-/***********************************************************************************************************
- * Public interface
- ***********************************************************************************************************/
-buffer_t buffer_new(int size) {
-    return buffer_new_from_data(NULL, size);
+// Move the elements to a new block of capacity, unwrapped from index 0
+static int deque_set_capacity(deque_t deque, int capacity) {
+    void **elements;
+    if (!(elements = (void **)utils_arena_malloc(deque->arena, sizeof(void *) * capacity))) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    int first = deque->capacity - deque->head;
+    if (first > deque->count) {
+        first = deque->count;
+    }
+    if (deque->count) {
+        memcpy(elements, deque->elements + deque->head, sizeof(void *) * first);
+        memcpy(elements + first, deque->elements, sizeof(void *) * (deque->count - first));
+    }
+    utils_arena_release(deque->arena, deque->elements, sizeof(void *) * deque->capacity);
+    UTILS_STATS_RESIZE(UTILS_STATS_ARRAY, deque->arena, sizeof(void *) * deque->capacity, sizeof(void *) * capacity);
+    deque->elements = elements;
+    deque->capacity = capacity;
+    deque->head = 0;
+    return UTILS_ERR_OK;
 }
 
-void buffer_free(void *p) {
-    buffer_t buffer = (buffer_t)p;
-    if (buffer) {
-        if (buffer->data && !buffer->static_data) free(buffer->data);
-        free(p);
+static int deque_ensure_capacity(deque_t deque, int count) {
+    if (count <= deque->capacity) {
+        return UTILS_ERR_OK;
+    }
+    int capacity = deque->capacity ? deque->capacity : DEQUE_MIN_CAPACITY;
+    while (capacity < count) {
+        capacity *= 2;
     }
+    return deque_set_capacity(deque, capacity);
 }
 
-buffer_t buffer_new_from_data(unsigned char *data, int size) {
-    buffer_t buffer;
-    if (!(buffer = (buffer_t)malloc(sizeof(struct _buffer)))) {
-        errno = UTILS_ERR_ALLOC_FAILED;
-        return NULL;
-    }
-    memset(buffer, 0, sizeof(struct _buffer));
-    if (data) {
-        buffer->data = data;
-        buffer->pos = size;
+deque_t deque_new(element_free *free_callback) {
+    return deque_new_in(NULL, free_callback);
+}
+
+deque_t deque_new_in(utils_arena_t arena, element_free *free_callback) {
+    deque_t deque;
+    if (!(deque = (deque_t)utils_arena_malloc(arena, sizeof(struct _deque)))) {
+        goto cleanup;
     }
-    else if ((buffer->data = malloc(size + 1))) {
-        memset(buffer->data, 0, size + 1);
+    memset(deque, 0, sizeof(struct _deque));
+    deque->free_callback = free_callback;
+    deque->arena = arena;
+    UTILS_STATS_NEW(UTILS_STATS_ARRAY, arena, sizeof(struct _deque));
+    return deque;
+cleanup:
+    errno = UTILS_ERR_ALLOC_FAILED;
+    return NULL;
+}
+
+void deque_free(void *d) {
+    deque_t deque = (deque_t)d;
+    if (deque) {
+        deque_clear(deque);
+        UTILS_STATS_DELETE(UTILS_STATS_ARRAY, deque->arena, sizeof(struct _deque) + sizeof(void *) * deque->capacity);
+        utils_arena_release(deque->arena, deque->elements, sizeof(void *) * deque->capacity);
+        utils_arena_release(deque->arena, d, sizeof(struct _deque));
     }
-    else {
-        errno = UTILS_ERR_ALLOC_FAILED;
-        free(buffer);
-        return NULL;
+}
+
+int deque_count(deque_t deque) {
+    return deque->count;
+}
+
+int deque_capacity(deque_t deque) {
+    return deque->capacity;
+}
+
+int deque_reserve(deque_t deque, int capacity) {
+    return deque_ensure_capacity(deque, capacity);
+}
+
+int deque_push_back(deque_t deque, void *element) {
+    if (deque_ensure_capacity(deque, deque->count + 1) != UTILS_ERR_OK) {
+        return UTILS_ERR_ALLOC_FAILED;
     }
-    buffer->size = size;
-    return buffer;
+    deque->elements[(deque->head + deque->count) & (deque->capacity - 1)] = element;
+    deque->count++;
+    return UTILS_ERR_OK;
 }
 
-buffer_t buffer_new_from_static_data(const unsigned char *data, int size) {
-    buffer_t buffer = buffer_new_from_data((unsigned char *)data, size);
-    if (buffer) {
-        buffer->static_data = true;
+int deque_push_front(deque_t deque, void *element) {
+    if (deque_ensure_capacity(deque, deque->count + 1) != UTILS_ERR_OK) {
+        return UTILS_ERR_ALLOC_FAILED;
     }
-    return buffer;
+    deque->head = (deque->head - 1) & (deque->capacity - 1);
+    deque->elements[deque->head] = element;
+    deque->count++;
+    return UTILS_ERR_OK;
 }
 
-buffer_t buffer_new_from_string(char *string) {
-    return buffer_new_from_data((unsigned char *)string, strlen(string));
+void *deque_pop_front(deque_t deque) {
+    if (!deque->count) {
+        return NULL;
+    }
+    void *element = deque->elements[deque->head];
+    deque->head = (deque->head + 1) & (deque->capacity - 1);
+    deque->count--;
+    return element;
 }
 
-buffer_t buffer_new_from_mpi(mbedtls_mpi *mpi) {
-    unsigned char *mpi_data;
-    int mpi_size = mbedtls_mpi_size(mpi);
-    mpi_data = (unsigned char*)malloc(sizeof(unsigned char) * mpi_size);
-    if (!mpi_data) {
-        errno = UTILS_ERR_ALLOC_FAILED;
+void *deque_pop_back(deque_t deque) {
+    if (!deque->count) {
         return NULL;
     }
-    mbedtls_mpi_write_binary(mpi, mpi_data, mpi_size);
-    return buffer_new_from_data(mpi_data, mpi_size);
+    deque->count--;
+    return deque->elements[(deque->head + deque->count) & (deque->capacity - 1)];
 }
 
-buffer_t buffer_clone(buffer_t buffer) {
-    buffer_t clone = buffer_new(buffer_get_length(buffer));
-    buffer_append_buffer(clone, buffer);
-    return clone;
+void *deque_at(deque_t deque, int index) {
+    if (index >= 0 && index < deque->count) {
+        return deque->elements[(deque->head + index) & (deque->capacity - 1)];
+    }
+    return NULL;
 }
 
-int buffer_get_length(buffer_t buffer) {
-    return buffer->pos;
+void *deque_replace(deque_t deque, int index, void *element) {
+    if (index >= 0 && index < deque->count) {
+        void **slot = &deque->elements[(deque->head + index) & (deque->capacity - 1)];
+        void *old_element = *slot;
+        *slot = element;
+        return old_element;
+    }
+    return NULL;
 }
 
-const unsigned char *buffer_get_data(buffer_t buffer) {
-    return buffer->data;
+void deque_clear(deque_t deque) {
+    if (deque->free_callback) {
+        for (int i = 0; i < deque->count; i++) {
+            deque->free_callback(deque->elements[(deque->head + i) & (deque->capacity - 1)]);
+        }
+    }
+    deque->head = 0;
+    deque->count = 0;
 }
 
-unsigned char *buffer_detach_data(buffer_t buffer) {
-    unsigned char *data = buffer->data;
-    buffer->data = NULL;
-    buffer->pos = 0;
-    buffer->size = 0;
-    return data;
+/***********************************************************************************************************
+ * Priority queue
+ ***********************************************************************************************************/
+// Binary min-heap. Three arrays, all with the same growth as any array:
+//   heap       the elements, in heap order
+//   handles    the handle of each element of heap
+//   positions  the index in heap of each handle, or -2 - the next free handle for free handles
+struct _pqueue {
+    array_t heap;
+    array_t handles;
+    array_t positions;
+    element_compare *compare;
+    element_free *free_callback;
+    utils_arena_t arena;
+    // First free handle, or -1
+    intptr_t free_handle;
+};
+
+static void pqueue_place(pqueue_t queue, int index, void *element, intptr_t handle) {
+    queue->heap->elements[index] = element;
+    queue->handles->elements[index] = (void *)handle;
+    queue->positions->elements[handle] = (void *)(intptr_t)index;
 }
 
-// If max_size <= 0 the buffer will not resize automatically
-// If max_size > current size, the buffer will resize automatically up to max_size.
-// Return number of bytes written or UTILS_ERR_OUT_OF_MEMORY if realloc failed
-int buffer_append(buffer_t buffer, const unsigned char *data, int len) {
-    int ret;
-    if (!(ret = buffer_ensure_available(buffer, len))) {
-        memcpy(buffer->data + buffer->pos, data, len);
-        buffer->pos+= len;
+// Move the element at index towards the top, moving a hole rather than swapping. Return where it ends
+static int pqueue_sift_up(pqueue_t queue, int index) {
+    void **elements = queue->heap->elements;
+    void **handles = queue->handles->elements;
+    void *element = elements[index];
+    intptr_t handle = (intptr_t)handles[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (queue->compare(element, elements[parent]) >= 0) {
+            break;
+        }
+        pqueue_place(queue, index, elements[parent], (intptr_t)handles[parent]);
+        index = parent;
     }
-    return ret;
+    pqueue_place(queue, index, element, handle);
+    return index;
 }
 
-int buffer_append_string(buffer_t buffer, const char *data) {
-    return buffer_append(buffer, (const unsigned char *)data, strlen(data));
+static void pqueue_sift_down(pqueue_t queue, int index) {
+    void **elements = queue->heap->elements;
+    void **handles = queue->handles->elements;
+    int count = queue->heap->count;
+    void *element = elements[index];
+    intptr_t handle = (intptr_t)handles[index];
+    for (int child; (child = index * 2 + 1) < count; index = child) {
+        if (child + 1 < count && queue->compare(elements[child + 1], elements[child]) < 0) {
+            child++;
+        }
+        if (queue->compare(elements[child], element) >= 0) {
+            break;
+        }
+        pqueue_place(queue, index, elements[child], (intptr_t)handles[child]);
+    }
+    pqueue_place(queue, index, element, handle);
 }
 
-int buffer_append_buffer(buffer_t buffer, const buffer_t data) {
-    return buffer_append(buffer, buffer_get_data(data), buffer_get_length(data));
+static bool pqueue_valid_handle(pqueue_t queue, int handle) {
+    return handle >= 0 && handle < queue->positions->count && (intptr_t)queue->positions->elements[handle] >= 0;
 }
 
-int buffer_append_mpi(buffer_t buffer, mbedtls_mpi *data) {
-    int ret;
-    int mpi_size = mbedtls_mpi_size(data);
-    if (!(ret = buffer_ensure_available(buffer, mpi_size))) {
-        mbedtls_mpi_write_binary(data, buffer->data + buffer->pos, mpi_size);
-        buffer->pos+= mpi_size;
-    }
-    return ret;
+static void pqueue_release_handle(pqueue_t queue, intptr_t handle) {
+    queue->positions->elements[handle] = (void *)(-2 - queue->free_handle);
+    queue->free_handle = handle;
 }
 
-int buffer_ensure_available(buffer_t buffer, int len) {
-    int available = buffer->size - buffer->pos;
-    // Buffer was created with no resizing
-    if (len > available) {
-        int new_size = buffer->pos + len;
-        if (buffer_resize(buffer, new_size) != UTILS_ERR_OK) {
-            return UTILS_ERR_OUT_OF_MEMORY;
+// Take the element at index out of the heap and release its handle
+static void *pqueue_remove_at(pqueue_t queue, int index) {
+    void *element = queue->heap->elements[index];
+    pqueue_release_handle(queue, (intptr_t)queue->handles->elements[index]);
+    void *last = array_pop(queue->heap);
+    intptr_t last_handle = (intptr_t)array_pop(queue->handles);
+    if (index < queue->heap->count) {
+        pqueue_place(queue, index, last, last_handle);
+        if (pqueue_sift_up(queue, index) == index) {
+            pqueue_sift_down(queue, index);
         }
-    };
-    return UTILS_ERR_OK;
+    }
+    return element;
 }
 
-int buffer_resize(buffer_t buffer, int new_size) {
-    if (new_size < 0) {
-        return UTILS_ERR_OUT_OF_MEMORY;
+pqueue_t pqueue_new(element_compare *compare, element_free *free_callback) {
+    return pqueue_new_in(NULL, compare, free_callback);
+}
+
+pqueue_t pqueue_new_in(utils_arena_t arena, element_compare *compare, element_free *free_callback) {
+    pqueue_t queue;
+    if (!(queue = (pqueue_t)utils_arena_malloc(arena, sizeof(struct _pqueue)))) {
+        goto cleanup;
     }
-    if (!(buffer->data = realloc(buffer->data, new_size + 1))) {
-        return UTILS_ERR_OUT_OF_MEMORY;
+    memset(queue, 0, sizeof(struct _pqueue));
+    queue->compare = compare;
+    queue->free_callback = free_callback;
+    queue->arena = arena;
+    queue->free_handle = -1;
+    UTILS_STATS_NEW(UTILS_STATS_ARRAY, arena, sizeof(struct _pqueue));
+    if (!(queue->heap = array_create(arena, NULL, UTILS_STATS_ARRAY)) ||
+        !(queue->handles = array_create(arena, NULL, UTILS_STATS_ARRAY)) ||
+        !(queue->positions = array_create(arena, NULL, UTILS_STATS_ARRAY))) {
+        goto cleanup;
     }
-    bool is_shrunk = (new_size < buffer->size);
-    int zero_len = is_shrunk ? 1 : new_size - buffer->size + 1;
-    int zero_offset = is_shrunk ? new_size : buffer->size;
-    memset(buffer->data + zero_offset, 0, zero_len);
-    buffer->size = new_size;
-    buffer->pos = (buffer->pos > new_size) ? new_size : buffer->pos;
-    return UTILS_ERR_OK;
+    return queue;
+cleanup:
+    pqueue_free(queue);
+    errno = UTILS_ERR_ALLOC_FAILED;
+    return NULL;
+}
+
+void pqueue_free(void *q) {
+    pqueue_t queue = (pqueue_t)q;
+    if (queue) {
+        if (queue->heap) {
+            pqueue_clear(queue);
+        }
+        array_free(queue->heap);
+        array_free(queue->handles);
+        array_free(queue->positions);
+        UTILS_STATS_DELETE(UTILS_STATS_ARRAY, queue->arena, sizeof(struct _pqueue));
+        utils_arena_release(queue->arena, q, sizeof(struct _pqueue));
+    }
+}
+
+int pqueue_count(pqueue_t queue) {
+    return queue->heap->count;
+}
+
+int pqueue_push(pqueue_t queue, void *element) {
+    // Make room first, so that nothing needs undoing
+    int count = queue->heap->count;
+    if (array_ensure_capacity(queue->heap, count + 1) != UTILS_ERR_OK ||
+        array_ensure_capacity(queue->handles, count + 1) != UTILS_ERR_OK ||
+        (queue->free_handle < 0 && array_ensure_capacity(queue->positions, queue->positions->count + 1) != UTILS_ERR_OK)) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    intptr_t handle = queue->free_handle;
+    if (handle >= 0) {
+        queue->free_handle = -2 - (intptr_t)queue->positions->elements[handle];
+    }
+    else {
+        handle = queue->positions->count++;
+    }
+    queue->heap->count++;
+    queue->handles->count++;
+    pqueue_place(queue, count, element, handle);
+    pqueue_sift_up(queue, count);
+    return (int)handle;
+}
+
+void *pqueue_peek(pqueue_t queue) {
+    return queue->heap->count ? queue->heap->elements[0] : NULL;
+}
+
+void *pqueue_pop(pqueue_t queue) {
+    return queue->heap->count ? pqueue_remove_at(queue, 0) : NULL;
+}
+
+void *pqueue_get(pqueue_t queue, int handle) {
+    if (!pqueue_valid_handle(queue, handle)) {
+        return NULL;
+    }
+    return queue->heap->elements[(intptr_t)queue->positions->elements[handle]];
+}
+
+int pqueue_update(pqueue_t queue, int handle) {
+    if (!pqueue_valid_handle(queue, handle)) {
+        return UTILS_ERR_OUT_OF_RANGE;
+    }
+    int index = (int)(intptr_t)queue->positions->elements[handle];
+    if (pqueue_sift_up(queue, index) == index) {
+        pqueue_sift_down(queue, index);
+    }
+    return UTILS_ERR_OK;
+}
+
+void *pqueue_remove(pqueue_t queue, int handle) {
+    if (!pqueue_valid_handle(queue, handle)) {
+        return NULL;
+    }
+    return pqueue_remove_at(queue, (int)(intptr_t)queue->positions->elements[handle]);
+}
+
+void pqueue_clear(pqueue_t queue) {
+    if (queue->free_callback) {
+        for (int i = 0; i < queue->heap->count; i++) {
+            queue->free_callback(queue->heap->elements[i]);
+        }
+    }
+    queue->heap->count = 0;
+    queue->handles->count = 0;
+    queue->positions->count = 0;
+    queue->free_handle = -1;
+}
+
+/***********************************************************************************************************
+ * Map
+ ***********************************************************************************************************/
+// Keys and values are kept in insertion order in two parallel arrays. A hash
+// index maps each key to its position in those arrays. The index uses open
+// addressing with Robin Hood probing and backward shift deletion.
+// When the index grows, the entries of the old index are moved to the new one
+// a few clusters at a time, on every operation, so that no single call pays for
+// a full rehash.
+#define MAP_MIN_CAPACITY            8
+// Maximum load of the index, in eighths
+#define MAP_MAX_LOAD                7
+// Minimum number of old index slots migrated on each update during a rehash
+#define MAP_REHASH_STEP             4
+
+struct _map_slot {
+    uint32_t hash;
+    // Position of the entry in keys/values, -1 if the slot is empty
+    int index;
+};
+
+struct _map_index {
+    struct _map_slot *slots;
+    int capacity;
+};
+
+struct _map {
+    utils_arena_t arena;
+    // Where keys are stored, if they are interned
+    intern_pool_t pool;
+    // Entries in insertion order. Removed entries leave a NULL key behind until the next compaction
+    array_t keys;
+    array_t values;
+    int removed;
+    struct _map_index index;
+    // Index being migrated to the new one, if a rehash is in progress
+    struct _map_index old_index;
+    int rehash_pos;
+    int rehash_left;
+};
+
+static uint32_t map_hash(const char *key) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (unsigned char)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Distance of the slot at pos from the home slot of hash
+static int map_distance(int mask, int pos, uint32_t hash) {
+    return (pos - (int)(hash & mask)) & mask;
+}
+
+static int map_index_init(map_t map, struct _map_index *index, int capacity) {
+    if (!(index->slots = (struct _map_slot *)utils_arena_malloc(map->arena, sizeof(struct _map_slot) * capacity))) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    // All bits set: index -1
+    memset(index->slots, 0xFF, sizeof(struct _map_slot) * capacity);
+    UTILS_STATS_RESIZE(UTILS_STATS_MAP, map->arena, 0, sizeof(struct _map_slot) * capacity);
+    index->capacity = capacity;
+    return UTILS_ERR_OK;
+}
+
+static void map_index_free(map_t map, struct _map_index *index) {
+    UTILS_STATS_RESIZE(UTILS_STATS_MAP, map->arena, sizeof(struct _map_slot) * index->capacity, 0);
+    utils_arena_release(map->arena, index->slots, sizeof(struct _map_slot) * index->capacity);
+    index->slots = NULL;
+    index->capacity = 0;
+}
+
+static void map_index_insert(struct _map_index *index, uint32_t hash, int position) {
+    int mask = index->capacity - 1;
+    int pos = (int)(hash & mask);
+    int dist = 0;
+    struct _map_slot entry = { hash, position };
+    while (index->slots[pos].index >= 0) {
+        int slot_dist = map_distance(mask, pos, index->slots[pos].hash);
+        // Take from the rich: the entry closer to its home slot moves on
+        if (slot_dist < dist) {
+            struct _map_slot tmp = index->slots[pos];
+            index->slots[pos] = entry;
+            entry = tmp;
+            dist = slot_dist;
+        }
+        pos = (pos + 1) & mask;
+        dist++;
+    }
+    index->slots[pos] = entry;
+}
+
+// Return the slot holding key, or -1
+static int map_index_find(map_t map, struct _map_index *index, uint32_t hash, const char *key) {
+    if (!index->capacity) {
+        return -1;
+    }
+    int mask = index->capacity - 1;
+    int pos = (int)(hash & mask);
+    for (int dist = 0; ; dist++, pos = (pos + 1) & mask) {
+        struct _map_slot *slot = &index->slots[pos];
+        if (slot->index < 0 || map_distance(mask, pos, slot->hash) < dist) {
+            UTILS_STATS_PROBE(dist);
+            return -1;
+        }
+        // Interned keys are likely to be the very same pointer
+        const char *slot_key = map->keys->elements[slot->index];
+        if (slot->hash == hash && (slot_key == key || !strcmp(slot_key, key))) {
+            UTILS_STATS_PROBE(dist);
+            return pos;
+        }
+    }
+}
+
+static void map_index_remove(struct _map_index *index, int pos) {
+    int mask = index->capacity - 1;
+    int next = (pos + 1) & mask;
+    // Backward shift the rest of the cluster
+    while (index->slots[next].index >= 0 && map_distance(mask, next, index->slots[next].hash) > 0) {
+        index->slots[pos] = index->slots[next];
+        pos = next;
+        next = (next + 1) & mask;
+    }
+    index->slots[pos].index = -1;
+}
+
+// Migrate at least count slots of the old index. Migration always stops on an
+// empty slot, so that the clusters left in the old index stay whole and
+// can still be probed.
+static void map_rehash_step(map_t map, int count) {
+    struct _map_index *old_index = &map->old_index;
+    int mask = old_index->capacity - 1;
+    while (map->rehash_left > 0 && (count-- > 0 || old_index->slots[map->rehash_pos].index >= 0)) {
+        struct _map_slot *slot = &old_index->slots[map->rehash_pos];
+        if (slot->index >= 0) {
+            map_index_insert(&map->index, slot->hash, slot->index);
+            slot->index = -1;
+        }
+        map->rehash_pos = (map->rehash_pos + 1) & mask;
+        map->rehash_left--;
+    }
+    if (!map->rehash_left) {
+        map_index_free(map, old_index);
+    }
+}
+
+static int map_grow(map_t map) {
+    if (map->old_index.capacity) {
+        map_rehash_step(map, map->rehash_left);
+    }
+    int capacity = map->index.capacity ? map->index.capacity * 2 : MAP_MIN_CAPACITY;
+    struct _map_index new_index;
+    if (map_index_init(map, &new_index, capacity) != UTILS_ERR_OK) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    if (map->index.capacity) {
+        map->old_index = map->index;
+        map->rehash_left = map->old_index.capacity;
+        // Start on an empty slot, there is always one
+        map->rehash_pos = 0;
+        while (map->old_index.slots[map->rehash_pos].index >= 0) {
+            map->rehash_pos++;
+        }
+    }
+    map->index = new_index;
+    return UTILS_ERR_OK;
+}
+
+// Look up key in both indexes, for updates. Return the slot, or -1, and the index holding it
+static int map_find(map_t map, uint32_t hash, const char *key, struct _map_index **index) {
+    int pos;
+    if (map->old_index.capacity) {
+        map_rehash_step(map, MAP_REHASH_STEP);
+    }
+    *index = &map->index;
+    if ((pos = map_index_find(map, &map->index, hash, key)) < 0 && map->old_index.capacity) {
+        *index = &map->old_index;
+        pos = map_index_find(map, &map->old_index, hash, key);
+    }
+    return pos;
+}
+
+static char *map_key_new(map_t map, const char *key) {
+    if (map->pool) {
+        return (char *)intern_pool_acquire(map->pool, key);
+    }
+    UTILS_STATS_RESIZE(UTILS_STATS_MAP, map->arena, 0, strlen(key) + 1);
+    return utils_arena_strdup(map->arena, key);
+}
+
+static void map_key_free(map_t map, char *key) {
+    if (map->pool) {
+        intern_pool_release(map->pool, key);
+        return;
+    }
+    UTILS_STATS_RESIZE(UTILS_STATS_MAP, map->arena, strlen(key) + 1, 0);
+    // The size only matters to arenas
+    utils_arena_release(map->arena, key, map->arena ? strlen(key) + 1 : 0);
+}
+
+// Leave a hole at the position of the entry, so that the others keep their place and order.
+// Holes at the end are dropped right away
+static void *map_remove_at(map_t map, struct _map_index *index, int pos) {
+    int position = index->slots[pos].index;
+    map_index_remove(index, pos);
+    map_key_free(map, map->keys->elements[position]);
+    void *value = map->values->elements[position];
+    map->keys->elements[position] = NULL;
+    map->values->elements[position] = NULL;
+    map->removed++;
+    while (map->removed && !map->keys->elements[map->keys->count - 1]) {
+        map->keys->count--;
+        map->values->count--;
+        map->removed--;
+    }
+    return value;
+}
+
+// Squeeze the holes out and index the entries at their new positions
+static void map_compact(map_t map) {
+    if (map->old_index.capacity) {
+        map_rehash_step(map, map->rehash_left);
+    }
+    int kept = 0;
+    for (int i = 0; i < map->keys->count; i++) {
+        if (map->keys->elements[i]) {
+            map->keys->elements[kept] = map->keys->elements[i];
+            map->values->elements[kept++] = map->values->elements[i];
+        }
+    }
+    map->keys->count = kept;
+    map->values->count = kept;
+    map->removed = 0;
+    memset(map->index.slots, 0xFF, sizeof(struct _map_slot) * map->index.capacity);
+    for (int i = 0; i < kept; i++) {
+        map_index_insert(&map->index, map_hash(map->keys->elements[i]), i);
+    }
+}
+
+// Compact once the holes outnumber the entries, which keeps removal amortized constant time
+static void map_compact_if_sparse(map_t map) {
+    if (map->removed > map->keys->count - map->removed) {
+        map_compact(map);
+    }
+}
+
+map_t map_new(element_free *free_callback) {
+    return map_new_in(NULL, free_callback);
+}
+
+map_t map_new_in(utils_arena_t arena, element_free *free_callback) {
+    map_t map;
+    if (!(map = (map_t)utils_arena_malloc(arena, sizeof(struct _map)))) {
+        goto cleanup;
+    }
+    memset(map, 0, sizeof(struct _map));
+    map->arena = arena;
+    UTILS_STATS_NEW(UTILS_STATS_MAP, arena, sizeof(struct _map));
+    // Keys are released by the map, they may come from the arena
+    if (!(map->keys = array_create(arena, NULL, UTILS_STATS_MAP))) {
+        goto cleanup;
+    }
+    if (!(map->values = array_create(arena, free_callback, UTILS_STATS_MAP))) {
+        goto cleanup;
+    }
+    return map;
+cleanup:
+    map_free(map);
+    errno = UTILS_ERR_ALLOC_FAILED;
+    return NULL;
+}
+
+map_t map_new_with_pool(intern_pool_t pool, element_free *free_callback) {
+    map_t map;
+    if ((map = map_new_in(NULL, free_callback))) {
+        map->pool = pool;
+    }
+    return map;
+}
+
+void map_free(void *m) {
+    map_t map = (map_t)m;
+    if (map) {
+        if (map->keys) {
+            for (int i = 0; i < map->keys->count; i++) {
+                if (map->keys->elements[i]) {
+                    map_key_free(map, map->keys->elements[i]);
+                }
+            }
+        }
+        array_free(map->keys);
+        array_free(map->values);
+        map_index_free(map, &map->index);
+        map_index_free(map, &map->old_index);
+        UTILS_STATS_DELETE(UTILS_STATS_MAP, map->arena, sizeof(struct _map));
+        utils_arena_release(map->arena, m, sizeof(struct _map));
+    }
+}
+
+int map_count(map_t map) {
+    return map->keys->count - map->removed;
+}
+
+array_t map_keys(map_t map) {
+    if (map->removed) {
+        map_compact(map);
+    }
+    return map->keys;
+}
+
+array_t map_values(map_t map) {
+    if (map->removed) {
+        map_compact(map);
+    }
+    return map->values;
+}
+
+element_free *map_get_free_callback(map_t map) {
+    return map->values->free_callback;
+}
+
+// Lookup that leaves the index alone, so that maps can be shared read-only
+static void *map_lookup(map_t map, const char *key) {
+    uint32_t hash = map_hash(key);
+    struct _map_index *index = &map->index;
+    int pos = map_index_find(map, index, hash, key);
+    if (pos < 0 && map->old_index.capacity) {
+        index = &map->old_index;
+        pos = map_index_find(map, index, hash, key);
+    }
+    if (pos < 0) {
+        return NULL;
+    }
+    return map->values->elements[index->slots[pos].index];
+}
+
+void *map_value_for_key(map_t map, const char *key) {
+    return map_lookup(map, key);
+}
+
+// Add an entry for a key that isn't in the map. On failure the map is left as it was
+static int map_append(map_t map, uint32_t hash, const char *key, void *value) {
+    if ((map_count(map) + 1) * 8 > map->index.capacity * MAP_MAX_LOAD) {
+        if (map_grow(map) != UTILS_ERR_OK) {
+            return UTILS_ERR_ALLOC_FAILED;
+        }
+    }
+    char *new_key;
+    if (!(new_key = map_key_new(map, key))) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    if (array_push(map->keys, new_key) != UTILS_ERR_OK) {
+        map_key_free(map, new_key);
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    if (array_push(map->values, value) != UTILS_ERR_OK) {
+        map_key_free(map, array_pop(map->keys));
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    map_index_insert(&map->index, hash, map->keys->count - 1);
+    return UTILS_ERR_OK;
+}
+
+void *map_set_value_for_key(map_t map, const char *key, void *value) {
+    struct _map_index *index;
+    uint32_t hash = map_hash(key);
+    int pos = map_find(map, hash, key, &index);
+    if (pos >= 0) {
+        return array_replace(map->values, index->slots[pos].index, value);
+    }
+    if (map_append(map, hash, key, value) != UTILS_ERR_OK) {
+        errno = UTILS_ERR_ALLOC_FAILED;
+        return NULL;
+    }
+    return value;
+}
+
+int map_insert(map_t map, const char *key, void *value) {
+    struct _map_index *index;
+    uint32_t hash = map_hash(key);
+    if (map_find(map, hash, key, &index) >= 0) {
+        return UTILS_ERR_IN_USE;
+    }
+    return map_append(map, hash, key, value);
+}
+
+void *map_remove_value_for_key(map_t map, const char *key) {
+    struct _map_index *index;
+    int pos = map_find(map, map_hash(key), key, &index);
+    if (pos < 0) {
+        return NULL;
+    }
+    void *value = map_remove_at(map, index, pos);
+    map_compact_if_sparse(map);
+    return value;
+}
+
+void map_iterator_init(map_iterator_t *iterator, map_t map) {
+    memset(iterator, 0, sizeof(map_iterator_t));
+    iterator->map = map;
+    iterator->index = -1;
+}
+
+bool map_iterator_next(map_iterator_t *iterator) {
+    map_t map = iterator->map;
+    while (++iterator->index < map->keys->count) {
+        if (map->keys->elements[iterator->index]) {
+            iterator->key = map->keys->elements[iterator->index];
+            iterator->value = map->values->elements[iterator->index];
+            return true;
+        }
+    }
+    iterator->index = map->keys->count;
+    iterator->key = NULL;
+    iterator->value = NULL;
+    return false;
+}
+
+void *map_iterator_remove(map_iterator_t *iterator) {
+    map_t map = iterator->map;
+    if (!iterator->key) {
+        return NULL;
+    }
+    struct _map_index *index;
+    int pos = map_find(map, map_hash(iterator->key), iterator->key, &index);
+    // The map is only compacted by later updates, so the following entries stay in place
+    void *value = map_remove_at(map, index, pos);
+    iterator->key = NULL;
+    iterator->value = NULL;
+    return value;
+}
+
+/***********************************************************************************************************
+ * Intern pool
+ ***********************************************************************************************************/
+// A map of the interned strings to their reference count. The strings handed out are the
+// map's own keys, which don't move as long as they are in the map
+struct _intern_pool {
+    map_t strings;
+};
+
+intern_pool_t intern_pool_new(void) {
+    intern_pool_t pool;
+    if (!(pool = (intern_pool_t)malloc(sizeof(struct _intern_pool)))) {
+        goto cleanup;
+    }
+    if (!(pool->strings = map_new(NULL))) {
+        goto cleanup;
+    }
+    return pool;
+cleanup:
+    free(pool);
+    errno = UTILS_ERR_ALLOC_FAILED;
+    return NULL;
+}
+
+void intern_pool_free(void *p) {
+    intern_pool_t pool = (intern_pool_t)p;
+    if (pool) {
+        map_free(pool->strings);
+        free(p);
+    }
+}
+
+int intern_pool_count(intern_pool_t pool) {
+    return map_count(pool->strings);
+}
+
+const char *intern_pool_acquire(intern_pool_t pool, const char *string) {
+    map_t strings = pool->strings;
+    struct _map_index *index;
+    int pos = map_find(strings, map_hash(string), string, &index);
+    if (pos < 0) {
+        if (!map_set_value_for_key(strings, string, (void *)1)) {
+            return NULL;
+        }
+        return strings->keys->elements[strings->keys->count - 1];
+    }
+    int position = index->slots[pos].index;
+    strings->values->elements[position] = (void *)((uintptr_t)strings->values->elements[position] + 1);
+    return strings->keys->elements[position];
+}
+
+void intern_pool_release(intern_pool_t pool, const char *string) {
+    map_t strings = pool->strings;
+    struct _map_index *index;
+    int pos = map_find(strings, map_hash(string), string, &index);
+    if (pos >= 0) {
+        int position = index->slots[pos].index;
+        uintptr_t refcount = (uintptr_t)strings->values->elements[position] - 1;
+        if (refcount) {
+            strings->values->elements[position] = (void *)refcount;
+        }
+        else {
+            map_remove_at(strings, index, pos);
+            map_compact_if_sparse(strings);
+        }
+    }
+}
+
+/***********************************************************************************************************
+ * Concurrent map
+ ***********************************************************************************************************/
+// Reader counters are spread over stripes, picked by core, so that readers don't share a cache line
+#ifndef UTILS_CONCURRENT_MAP_STRIPES
+#define UTILS_CONCURRENT_MAP_STRIPES    portNUM_PROCESSORS
+#endif
+
+struct _concurrent_map_stripe {
+    // Readers in each of the two phases
+    atomic_int readers[2];
+    char padding[COLLECTIONS_CACHE_LINE - 2 * sizeof(atomic_int)];
+};
+
+// Readers look up the current snapshot, which is never modified. Writers copy it, change the copy,
+// publish it and wait for the readers of the old snapshot to be gone before freeing it
+struct _concurrent_map {
+    struct _concurrent_map_stripe stripes[UTILS_CONCURRENT_MAP_STRIPES];
+    _Atomic(map_t) current;
+    atomic_uint phase;
+    // Phase + 1 the writer waits for the readers of, or 0
+    atomic_uint waiting;
+    SemaphoreHandle_t write_lock;
+    // Given by the last reader of the phase the writer waits for
+    SemaphoreHandle_t drained;
+    // Keys are shared by all the snapshots
+    intern_pool_t keys;
+    element_free *free_callback;
+};
+
+// Wait for the readers that may still see the previous snapshot. Phases are flipped twice, so
+// readers that picked a phase right before a flip are waited for too. The writer sleeps on
+// drained, which the last reader leaving the phase gives. A give left over from an earlier wait
+// only makes the writer check the counters once more
+static void concurrent_map_synchronize(concurrent_map_t map) {
+    for (int i = 0; i < 2; i++) {
+        unsigned int phase = atomic_fetch_add(&map->phase, 1) & 1;
+        atomic_store(&map->waiting, phase + 1);
+        for (int stripe = 0; stripe < UTILS_CONCURRENT_MAP_STRIPES; ) {
+            if (atomic_load(&map->stripes[stripe].readers[phase])) {
+                xSemaphoreTake(map->drained, portMAX_DELAY);
+            }
+            else {
+                stripe++;
+            }
+        }
+        atomic_store(&map->waiting, 0);
+    }
+}
+
+static map_t concurrent_map_copy(concurrent_map_t map, map_t snapshot) {
+    map_t copy;
+    if (!(copy = map_new_with_pool(map->keys, NULL))) {
+        return NULL;
+    }
+    map_iterator_t iterator;
+    map_iterator_init(&iterator, snapshot);
+    while (map_iterator_next(&iterator)) {
+        errno = UTILS_ERR_OK;
+        if (!map_set_value_for_key(copy, iterator.key, iterator.value) && errno) {
+            map_free(copy);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+// Publish the new snapshot, then free the old one and the value it no longer holds
+static void concurrent_map_publish(concurrent_map_t map, map_t snapshot, void *old_value) {
+    map_t old_snapshot = atomic_exchange(&map->current, snapshot);
+    concurrent_map_synchronize(map);
+    map_free(old_snapshot);
+    if (old_value && map->free_callback) {
+        map->free_callback(old_value);
+    }
+}
+
+concurrent_map_t concurrent_map_new(element_free *free_callback) {
+    concurrent_map_t map = NULL;
+    map_t snapshot = NULL;
+    if (!(map = (concurrent_map_t)calloc(1, sizeof(struct _concurrent_map)))) {
+        goto cleanup;
+    }
+    if (!(map->keys = intern_pool_new())) {
+        goto cleanup;
+    }
+    if (!(snapshot = map_new_with_pool(map->keys, NULL))) {
+        goto cleanup;
+    }
+    if (!(map->write_lock = xSemaphoreCreateMutex())) {
+        goto cleanup;
+    }
+    if (!(map->drained = xSemaphoreCreateBinary())) {
+        goto cleanup;
+    }
+    atomic_init(&map->current, snapshot);
+    map->free_callback = free_callback;
+    return map;
+cleanup:
+    map_free(snapshot);
+    if (map) {
+        intern_pool_free(map->keys);
+        if (map->write_lock) {
+            vSemaphoreDelete(map->write_lock);
+        }
+    }
+    free(map);
+    errno = UTILS_ERR_ALLOC_FAILED;
+    return NULL;
+}
+
+void concurrent_map_free(void *m) {
+    concurrent_map_t map = (concurrent_map_t)m;
+    if (map) {
+        map_t snapshot = atomic_load(&map->current);
+        if (map->free_callback) {
+            for (int i = 0; i < snapshot->values->count; i++) {
+                map->free_callback(snapshot->values->elements[i]);
+            }
+        }
+        map_free(snapshot);
+        intern_pool_free(map->keys);
+        vSemaphoreDelete(map->write_lock);
+        vSemaphoreDelete(map->drained);
+        free(map);
+    }
+}
+
+int concurrent_map_read_begin(concurrent_map_t map) {
+    int stripe = xPortGetCoreID() % UTILS_CONCURRENT_MAP_STRIPES;
+    int phase = atomic_load(&map->phase) & 1;
+    atomic_fetch_add(&map->stripes[stripe].readers[phase], 1);
+    // The task may move to another core, the token says which counter to decrement
+    return stripe << 1 | phase;
+}
+
+void concurrent_map_read_end(concurrent_map_t map, int token) {
+    unsigned int phase = token & 1;
+    if (atomic_fetch_sub(&map->stripes[token >> 1].readers[phase], 1) == 1 &&
+        atomic_load(&map->waiting) == phase + 1) {
+        xSemaphoreGive(map->drained);
+    }
+}
+
+int concurrent_map_count(concurrent_map_t map) {
+    return map_count(atomic_load(&map->current));
+}
+
+void *concurrent_map_value_for_key(concurrent_map_t map, const char *key) {
+    return map_lookup(atomic_load(&map->current), key);
+}
+
+int concurrent_map_set_value_for_key(concurrent_map_t map, const char *key, void *value) {
+    xSemaphoreTake(map->write_lock, portMAX_DELAY);
+    map_t snapshot = atomic_load(&map->current);
+    void *old_value = map_lookup(snapshot, key);
+    map_t copy;
+    if (!(copy = concurrent_map_copy(map, snapshot))) {
+        goto cleanup;
+    }
+    errno = UTILS_ERR_OK;
+    if (!map_set_value_for_key(copy, key, value) && errno) {
+        map_free(copy);
+        goto cleanup;
+    }
+    concurrent_map_publish(map, copy, (old_value != value) ? old_value : NULL);
+    xSemaphoreGive(map->write_lock);
+    return UTILS_ERR_OK;
+cleanup:
+    xSemaphoreGive(map->write_lock);
+    return UTILS_ERR_ALLOC_FAILED;
+}
+
+int concurrent_map_remove_value_for_key(concurrent_map_t map, const char *key) {
+    int ret = UTILS_ERR_OK;
+    xSemaphoreTake(map->write_lock, portMAX_DELAY);
+    map_t snapshot = atomic_load(&map->current);
+    if (map_lookup(snapshot, key)) {
+        map_t copy;
+        if ((copy = concurrent_map_copy(map, snapshot))) {
+            concurrent_map_publish(map, copy, map_remove_value_for_key(copy, key));
+        }
+        else {
+            ret = UTILS_ERR_ALLOC_FAILED;
+        }
+    }
+    xSemaphoreGive(map->write_lock);
+    return ret;
+}
+
+/***********************************************************************************************************
+ * Buffer
+ ***********************************************************************************************************/
+struct _buffer {
+    int size;
+    int pos;
+    unsigned char *data;
+    bool static_data;
+    // Automatic growth policy, see buffer_set_growth
+    int growth;
+    int max_size;
+    // Released when it drops to 0. Slices hold a reference to their parent
+    int refcount;
+    // Slices are read-only views on offset..offset + pos of their parent's data
+    buffer_t parent;
+    int offset;
+    // Where the header and the data live, NULL for the heap
+    utils_arena_t arena;
+    // Small payloads are stored here, data moves to the heap when they outgrow it
+    unsigned char inline_data[UTILS_BUFFER_INLINE_SIZE + 1];
+};
+
+static unsigned char *buffer_data(buffer_t buffer) {
+    if (buffer->parent) {
+        return buffer->parent->data + buffer->offset;
+    }
+    return buffer->data;
+}
+
+// Whether data was allocated by the buffer, as opposed to static or inline
+static bool buffer_owns_data(buffer_t buffer) {
+    return buffer->data && !buffer->static_data && buffer->data != buffer->inline_data;
+}
+
+static buffer_t buffer_alloc(utils_arena_t arena) {
+    buffer_t buffer;
+    if (!(buffer = (buffer_t)utils_arena_malloc(arena, sizeof(struct _buffer)))) {
+        errno = UTILS_ERR_ALLOC_FAILED;
+        return NULL;
+    }
+    memset(buffer, 0, sizeof(struct _buffer));
+    buffer->growth = UTILS_BUFFER_GROWTH_DOUBLE;
+    buffer->max_size = UTILS_BUFFER_NO_LIMIT;
+    buffer->refcount = 1;
+    buffer->arena = arena;
+    UTILS_STATS_NEW(UTILS_STATS_BUFFER, arena, sizeof(struct _buffer));
+    return buffer;
+}
+
+static buffer_t buffer_create(utils_arena_t arena, unsigned char *data, int size) {
+    buffer_t buffer;
+    if (!(buffer = buffer_alloc(arena))) {
+        return NULL;
+    }
+    if (data) {
+        buffer->data = data;
+        buffer->pos = size;
+    }
+    else if (size <= UTILS_BUFFER_INLINE_SIZE) {
+        // Already zeroed
+        buffer->data = buffer->inline_data;
+    }
+    else if ((buffer->data = utils_arena_malloc(arena, size + 1))) {
+        memset(buffer->data, 0, size + 1);
+        UTILS_STATS_RESIZE(UTILS_STATS_BUFFER, arena, 0, size + 1);
+    }
+    else {
+        errno = UTILS_ERR_ALLOC_FAILED;
+        UTILS_STATS_DELETE(UTILS_STATS_BUFFER, arena, sizeof(struct _buffer));
+        utils_arena_release(arena, buffer, sizeof(struct _buffer));
+        return NULL;
+    }
+    buffer->size = size;
+    return buffer;
+}
+
+/***********************************************************************************************************
+ * Public interface
+ ***********************************************************************************************************/
+buffer_t buffer_new(int size) {
+    return buffer_create(NULL, NULL, size);
+}
+
+buffer_t buffer_new_in(utils_arena_t arena, int size) {
+    return buffer_create(arena, NULL, size);
+}
+
+void buffer_free(void *p) {
+    buffer_t buffer = (buffer_t)p;
+    if (buffer && !--buffer->refcount) {
+        if (buffer->parent) {
+            buffer_free(buffer->parent);
+        }
+        else if (buffer_owns_data(buffer)) {
+            UTILS_STATS_RESIZE(UTILS_STATS_BUFFER, buffer->arena, buffer->size + 1, 0);
+            utils_arena_release(buffer->arena, buffer->data, buffer->size + 1);
+        }
+        UTILS_STATS_DELETE(UTILS_STATS_BUFFER, buffer->arena, sizeof(struct _buffer));
+        utils_arena_release(buffer->arena, p, sizeof(struct _buffer));
+    }
+}
+
+buffer_t buffer_new_from_data(unsigned char *data, int size) {
+    buffer_t buffer = buffer_create(NULL, data, size);
+    // The buffer takes ownership of the data
+    if (buffer && data) {
+        UTILS_STATS_RESIZE(UTILS_STATS_BUFFER, NULL, 0, size + 1);
+    }
+    return buffer;
+}
+
+buffer_t buffer_new_from_static_data(const unsigned char *data, int size) {
+    buffer_t buffer = buffer_create(NULL, (unsigned char *)data, size);
+    if (buffer) {
+        buffer->static_data = true;
+    }
+    return buffer;
+}
+
+buffer_t buffer_new_from_string(char *string) {
+    return buffer_new_from_data((unsigned char *)string, strlen(string));
+}
+
+buffer_t buffer_new_from_mpi(mbedtls_mpi *mpi) {
+    buffer_t buffer;
+    if (!(buffer = buffer_new(mbedtls_mpi_size(mpi)))) {
+        return NULL;
+    }
+    if (buffer_append_mpi(buffer, mpi)) {
+        buffer_free(buffer);
+        errno = UTILS_ERR_ALLOC_FAILED;
+        return NULL;
+    }
+    return buffer;
+}
+
+buffer_t buffer_slice(buffer_t parent, int offset, int len) {
+    buffer_t slice;
+    if (offset < 0 || len < 0 || offset + len > buffer_get_length(parent)) {
+        errno = UTILS_ERR_BUFFER_TOO_SMALL;
+        return NULL;
+    }
+    // Slices of slices share the storage of the root buffer
+    if (parent->parent) {
+        offset += parent->offset;
+        parent = parent->parent;
+    }
+    if (!(slice = buffer_alloc(parent->arena))) {
+        return NULL;
+    }
+    parent->refcount++;
+    slice->parent = parent;
+    slice->offset = offset;
+    slice->pos = len;
+    slice->size = len;
+    slice->growth = UTILS_BUFFER_GROWTH_FIXED;
+    slice->max_size = len;
+    return slice;
+}
+
+bool buffer_is_slice(buffer_t buffer) {
+    return buffer->parent != NULL;
+}
+
+buffer_t buffer_clone(buffer_t buffer) {
+    buffer_t clone = buffer_new(buffer_get_length(buffer));
+    buffer_append_buffer(clone, buffer);
+    return clone;
+}
+
+int buffer_get_length(buffer_t buffer) {
+    // The parent may have shrunk since the slice was taken
+    if (buffer->parent) {
+        int available = buffer->parent->pos - buffer->offset;
+        if (available < buffer->pos) {
+            return (available > 0) ? available : 0;
+        }
+    }
+    return buffer->pos;
+}
+
+const unsigned char *buffer_get_data(buffer_t buffer) {
+    return buffer_data(buffer);
+}
+
+unsigned char *buffer_detach_data(buffer_t buffer) {
+    // Slices can't give away storage they share
+    if (buffer->refcount > 1 || buffer->parent) {
+        errno = UTILS_ERR_READ_ONLY;
+        return NULL;
+    }
+    unsigned char *data = buffer->data;
+    // The caller frees the data, so it must come from the heap
+    if (data && (buffer->arena || !buffer_owns_data(buffer))) {
+        if (!(data = malloc(buffer->size + 1))) {
+            errno = UTILS_ERR_ALLOC_FAILED;
+            return NULL;
+        }
+        memcpy(data, buffer->data, buffer->size);
+        data[buffer->size] = 0;
+        if (buffer_owns_data(buffer)) {
+            utils_arena_release(buffer->arena, buffer->data, buffer->size + 1);
+        }
+    }
+    // Either way, the buffer no longer holds that memory
+    if (buffer_owns_data(buffer)) {
+        UTILS_STATS_RESIZE(UTILS_STATS_BUFFER, buffer->arena, buffer->size + 1, 0);
+    }
+    buffer->data = NULL;
+    buffer->pos = 0;
+    buffer->size = 0;
+    return data;
+}
+
+// Return UTILS_ERR_OK, UTILS_ERR_OUT_OF_MEMORY if realloc failed or
+// UTILS_ERR_BUFFER_TOO_SMALL if the growth policy doesn't allow the buffer to grow enough
+int buffer_append(buffer_t buffer, const unsigned char *data, int len) {
+    int ret;
+    if (!(ret = buffer_ensure_available(buffer, len))) {
+        memcpy(buffer->data + buffer->pos, data, len);
+        buffer->pos+= len;
+    }
+    return ret;
+}
+
+int buffer_append_string(buffer_t buffer, const char *data) {
+    return buffer_append(buffer, (const unsigned char *)data, strlen(data));
+}
+
+int buffer_append_buffer(buffer_t buffer, const buffer_t data) {
+    return buffer_append(buffer, buffer_get_data(data), buffer_get_length(data));
+}
+
+int buffer_append_mpi(buffer_t buffer, mbedtls_mpi *data) {
+    return buffer_append_mpi_padded(buffer, data, mbedtls_mpi_size(data));
+}
+
+int buffer_append_mpi_padded(buffer_t buffer, mbedtls_mpi *data, int width) {
+    int ret;
+    if ((int)mbedtls_mpi_size(data) > width) {
+        return UTILS_ERR_BUFFER_TOO_SMALL;
+    }
+    if (!(ret = buffer_ensure_available(buffer, width))) {
+        mbedtls_mpi_write_binary(data, buffer->data + buffer->pos, width);
+        buffer->pos+= width;
+    }
+    return ret;
+}
+
+int buffer_append_mpis(buffer_t buffer, mbedtls_mpi **data, int count, int width) {
+    int ret;
+    int len = 0;
+    for (int i = 0; i < count; i++) {
+        int mpi_size = mbedtls_mpi_size(data[i]);
+        if (width && mpi_size > width) {
+            return UTILS_ERR_BUFFER_TOO_SMALL;
+        }
+        len += width ? width : mpi_size;
+    }
+    if ((ret = buffer_ensure_available(buffer, len))) {
+        return ret;
+    }
+    for (int i = 0; i < count; i++) {
+        int mpi_size = width ? width : (int)mbedtls_mpi_size(data[i]);
+        mbedtls_mpi_write_binary(data[i], buffer->data + buffer->pos, mpi_size);
+        buffer->pos+= mpi_size;
+    }
+    return UTILS_ERR_OK;
+}
+
+int buffer_read_mpi(buffer_t buffer, int offset, int len, mbedtls_mpi *mpi) {
+    if (offset < 0 || len < 0 || offset + len > buffer_get_length(buffer)) {
+        return UTILS_ERR_BUFFER_TOO_SMALL;
+    }
+    const unsigned char *data = buffer_data(buffer);
+    if (mbedtls_mpi_read_binary(mpi, data ? data + offset : data, len)) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    return UTILS_ERR_OK;
+}
+
+int buffer_read_mpis(buffer_t buffer, int offset, int width, mbedtls_mpi **mpis, int count) {
+    int ret;
+    if (offset < 0 || width < 0 || count < 0 || (int64_t)width * count > buffer_get_length(buffer) - offset) {
+        return UTILS_ERR_BUFFER_TOO_SMALL;
+    }
+    for (int i = 0; i < count; i++) {
+        if ((ret = buffer_read_mpi(buffer, offset + i * width, width, mpis[i]))) {
+            return ret;
+        }
+    }
+    return UTILS_ERR_OK;
+}
+
+void buffer_set_growth(buffer_t buffer, int growth, int max_size) {
+    if (buffer->parent) {
+        return;
+    }
+    buffer->growth = growth;
+    buffer->max_size = max_size;
+}
+
+int buffer_ensure_available(buffer_t buffer, int len) {
+    if (buffer->parent) {
+        return UTILS_ERR_READ_ONLY;
+    }
+    int available = buffer->size - buffer->pos;
+    if (len > available) {
+        int needed = buffer->pos + len;
+        if (buffer->growth == UTILS_BUFFER_GROWTH_FIXED ||
+            (buffer->max_size != UTILS_BUFFER_NO_LIMIT && needed > buffer->max_size)) {
+            return UTILS_ERR_BUFFER_TOO_SMALL;
+        }
+        // Grow by the growth factor, but at least to what is needed and at most to max_size
+        int64_t new_size = (int64_t)buffer->size * buffer->growth / 100;
+        if (new_size < needed) {
+            new_size = needed;
+        }
+        if (buffer->max_size != UTILS_BUFFER_NO_LIMIT && new_size > buffer->max_size) {
+            new_size = buffer->max_size;
+        }
+        return buffer_resize(buffer, (int)new_size);
+    }
+    return UTILS_ERR_OK;
+}
+
+int buffer_resize(buffer_t buffer, int new_size) {
+    unsigned char *data;
+    if (buffer->parent) {
+        return UTILS_ERR_READ_ONLY;
+    }
+    if (new_size < 0) {
+        return UTILS_ERR_OUT_OF_MEMORY;
+    }
+    if (buffer->max_size != UTILS_BUFFER_NO_LIMIT && new_size > buffer->max_size) {
+        return UTILS_ERR_BUFFER_TOO_SMALL;
+    }
+    if (buffer_owns_data(buffer)) {
+        if (!(data = utils_arena_realloc(buffer->arena, buffer->data, buffer->size + 1, new_size + 1))) {
+            return UTILS_ERR_OUT_OF_MEMORY;
+        }
+        UTILS_STATS_RESIZE(UTILS_STATS_BUFFER, buffer->arena, buffer->size + 1, new_size + 1);
+    }
+    else {
+        // Inline or static data, which can't be reallocated
+        if (new_size <= UTILS_BUFFER_INLINE_SIZE) {
+            data = buffer->inline_data;
+        }
+        else if (!(data = utils_arena_malloc(buffer->arena, new_size + 1))) {
+            return UTILS_ERR_OUT_OF_MEMORY;
+        }
+        else {
+            UTILS_STATS_RESIZE(UTILS_STATS_BUFFER, buffer->arena, 0, new_size + 1);
+        }
+        if (buffer->data && buffer->data != data) {
+            memcpy(data, buffer->data, (new_size < buffer->size) ? new_size : buffer->size);
+        }
+        buffer->static_data = false;
+    }
+    buffer->data = data;
+    bool is_shrunk = (new_size < buffer->size);
+    int zero_len = is_shrunk ? 1 : new_size - buffer->size + 1;
+    int zero_offset = is_shrunk ? new_size : buffer->size;
+    memset(buffer->data + zero_offset, 0, zero_len);
+    buffer->size = new_size;
+    buffer->pos = (buffer->pos > new_size) ? new_size : buffer->pos;
+    return UTILS_ERR_OK;
 }
 
 void buffer_reset(buffer_t buffer) {
-    buffer->pos = 0;
+    if (buffer->parent) {
+        return;
+    }
+    // Everything past pos is already zero
     if (buffer->data) {
-        memset(buffer->data, 0, buffer->size);
+        memset(buffer->data, 0, buffer->pos);
+    }
+    buffer->pos = 0;
+}
+
+int buffer_truncate(buffer_t buffer, int len) {
+    if (buffer->parent) {
+        return UTILS_ERR_READ_ONLY;
+    }
+    if (len < 0 || len > buffer->pos) {
+        return UTILS_ERR_OUT_OF_RANGE;
+    }
+    memset(buffer->data + len, 0, buffer->pos - len);
+    buffer->pos = len;
+    return UTILS_ERR_OK;
+}
+
+/***********************************************************************************************************
+ * Buffer encoding
+ ***********************************************************************************************************/
+// Two lowercase hex digits for each byte value
+static const char buffer_hex_digits[] =
+    "000102030405060708090a0b0c0d0e0f"
+    "101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f"
+    "303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f"
+    "505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f"
+    "707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f"
+    "909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static const char buffer_base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Value of each hex digit, 0xFF for anything else
+static const uint8_t buffer_hex_values[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// Value of each base64 character, 0xFF for anything else, including padding
+static const uint8_t buffer_base64_values[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// Word at a time hex decoding. It works on the 8 bytes of a 64-bit word at once, each byte below
+// 0x80 so that adding to it never carries into the next one. Words are loaded and stored little
+// endian, as on the ESP32, other targets only use the tables. The encoders stay table driven,
+// a load per byte or per 6 bits is already less work than building the digits in a word
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define BUFFER_SWAR                 1
+#define BUFFER_SWAR_BYTES(byte)     ((uint64_t)(byte) * 0x0101010101010101ull)
+#define BUFFER_SWAR_HIGH_BITS       BUFFER_SWAR_BYTES(0x80)
+
+// 0x80 in each byte that is at least min
+static inline uint64_t buffer_swar_at_least(uint64_t word, uint8_t min) {
+    return (word + BUFFER_SWAR_BYTES(0x80 - min)) & BUFFER_SWAR_HIGH_BITS;
+}
+
+// 0x80 in each byte between min and max
+static inline uint64_t buffer_swar_between(uint64_t word, uint8_t min, uint8_t max) {
+    return buffer_swar_at_least(word, min) & ~buffer_swar_at_least(word, max + 1);
+}
+
+// Bytes of 8 hex digits. Set 0x80 in invalid for bad digits
+static inline uint32_t buffer_swar_hex_decode(const unsigned char *hex, uint64_t *invalid) {
+    uint64_t digits;
+    memcpy(&digits, hex, 8);
+    uint64_t decimal = buffer_swar_between(digits, '0', '9');
+    uint64_t letter = buffer_swar_between(digits | BUFFER_SWAR_BYTES(0x20), 'a', 'f');
+    *invalid |= (digits | ~(decimal | letter)) & BUFFER_SWAR_HIGH_BITS;
+    uint64_t nibbles = (digits & BUFFER_SWAR_BYTES(0x0F)) + (letter >> 7) * 9;
+    // Pair the nibbles in 16-bit lanes, then pack the lanes
+    uint64_t lanes = (nibbles << 4 | nibbles >> 8) & 0x00FF00FF00FF00FFull;
+    lanes = (lanes | lanes >> 8) & 0x0000FFFF0000FFFFull;
+    return (uint32_t)(lanes | lanes >> 16);
+}
+#endif
+
+int buffer_append_hex(buffer_t buffer, const unsigned char *data, int len) {
+    int ret;
+    if ((ret = buffer_ensure_available(buffer, len * 2))) {
+        return ret;
+    }
+    unsigned char *out = buffer->data + buffer->pos;
+    int i = 0;
+    for (; i + 4 <= len; i += 4, out += 8) {
+        memcpy(out, buffer_hex_digits + data[i] * 2, 2);
+        memcpy(out + 2, buffer_hex_digits + data[i + 1] * 2, 2);
+        memcpy(out + 4, buffer_hex_digits + data[i + 2] * 2, 2);
+        memcpy(out + 6, buffer_hex_digits + data[i + 3] * 2, 2);
+    }
+    for (; i < len; i++, out += 2) {
+        memcpy(out, buffer_hex_digits + data[i] * 2, 2);
+    }
+    buffer->pos += len * 2;
+    return UTILS_ERR_OK;
+}
+
+int buffer_append_from_hex(buffer_t buffer, const char *hex, int len) {
+    int ret;
+    if (len & 1) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    int out_len = len / 2;
+    if ((ret = buffer_ensure_available(buffer, out_len))) {
+        return ret;
+    }
+    const unsigned char *in = (const unsigned char *)hex;
+    unsigned char *out = buffer->data + buffer->pos;
+    // Invalid digits have the high bits set, which is checked once at the end
+    uint8_t invalid = 0;
+    int i = 0;
+#ifdef BUFFER_SWAR
+    uint64_t word_invalid = 0;
+    for (; i + 4 <= out_len; i += 4) {
+        uint32_t bytes = buffer_swar_hex_decode(in + i * 2, &word_invalid);
+        memcpy(out + i, &bytes, 4);
+    }
+    invalid = word_invalid ? 0xF0 : 0;
+#endif
+    for (; i < out_len; i++) {
+        uint8_t high = buffer_hex_values[in[i * 2]];
+        uint8_t low = buffer_hex_values[in[i * 2 + 1]];
+        invalid |= high | low;
+        out[i] = (uint8_t)(high << 4 | low);
+    }
+    if (invalid & 0xF0) {
+        // Keep everything past pos zero
+        memset(out, 0, out_len);
+        return UTILS_ERR_INVALID_DATA;
+    }
+    buffer->pos += out_len;
+    return UTILS_ERR_OK;
+}
+
+int buffer_append_base64(buffer_t buffer, const unsigned char *data, int len) {
+    int ret;
+    int out_len = (len + 2) / 3 * 4;
+    if ((ret = buffer_ensure_available(buffer, out_len))) {
+        return ret;
+    }
+    unsigned char *out = buffer->data + buffer->pos;
+    int i = 0;
+    for (; i + 3 <= len; i += 3, out += 4) {
+        uint32_t word = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 | data[i + 2];
+        out[0] = buffer_base64_digits[word >> 18];
+        out[1] = buffer_base64_digits[(word >> 12) & 0x3F];
+        out[2] = buffer_base64_digits[(word >> 6) & 0x3F];
+        out[3] = buffer_base64_digits[word & 0x3F];
+    }
+    if (i < len) {
+        uint32_t word = (uint32_t)data[i] << 16 | ((i + 1 < len) ? (uint32_t)data[i + 1] << 8 : 0);
+        out[0] = buffer_base64_digits[word >> 18];
+        out[1] = buffer_base64_digits[(word >> 12) & 0x3F];
+        out[2] = (i + 1 < len) ? buffer_base64_digits[(word >> 6) & 0x3F] : '=';
+        out[3] = '=';
+    }
+    buffer->pos += out_len;
+    return UTILS_ERR_OK;
+}
+
+int buffer_append_from_base64(buffer_t buffer, const char *base64, int len) {
+    int ret;
+    const unsigned char *in = (const unsigned char *)base64;
+    // Padding is optional
+    if (len && len % 4 == 0) {
+        len -= (in[len - 1] == '=') + (in[len - 1] == '=' && in[len - 2] == '=');
+    }
+    if (len % 4 == 1) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    int out_len = len / 4 * 3 + ((len % 4) ? len % 4 - 1 : 0);
+    if ((ret = buffer_ensure_available(buffer, out_len))) {
+        return ret;
+    }
+    unsigned char *out = buffer->data + buffer->pos;
+    // Invalid characters have the high bits set, which is checked once at the end
+    uint8_t invalid = 0;
+    int i = 0;
+    for (; i + 4 <= len; i += 4, out += 3) {
+        uint8_t a = buffer_base64_values[in[i]];
+        uint8_t b = buffer_base64_values[in[i + 1]];
+        uint8_t c = buffer_base64_values[in[i + 2]];
+        uint8_t d = buffer_base64_values[in[i + 3]];
+        invalid |= a | b | c | d;
+        uint32_t word = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | d;
+        out[0] = (uint8_t)(word >> 16);
+        out[1] = (uint8_t)(word >> 8);
+        out[2] = (uint8_t)word;
+    }
+    if (i < len) {
+        uint8_t a = buffer_base64_values[in[i]];
+        uint8_t b = buffer_base64_values[in[i + 1]];
+        uint8_t c = (i + 2 < len) ? buffer_base64_values[in[i + 2]] : 0;
+        invalid |= a | b | c;
+        uint32_t word = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6;
+        out[0] = (uint8_t)(word >> 16);
+        if (i + 2 < len) {
+            out[1] = (uint8_t)(word >> 8);
+        }
+    }
+    if (invalid & 0xC0) {
+        // Keep everything past pos zero
+        memset(buffer->data + buffer->pos, 0, out_len);
+        return UTILS_ERR_INVALID_DATA;
+    }
+    buffer->pos += out_len;
+    return UTILS_ERR_OK;
+}
+
+/***********************************************************************************************************
+ * Buffer reader
+ ***********************************************************************************************************/
+void buffer_reader_init(buffer_reader_t *reader, buffer_t buffer) {
+    buffer_reader_init_data(reader, buffer_get_data(buffer), buffer_get_length(buffer));
+    reader->buffer = buffer;
+}
+
+void buffer_reader_init_data(buffer_reader_t *reader, const unsigned char *data, int len) {
+    reader->buffer = NULL;
+    reader->data = data ? data : (const unsigned char *)"";
+    reader->length = data ? len : 0;
+    reader->pos = 0;
+    reader->error = UTILS_ERR_OK;
+}
+
+int buffer_reader_error(buffer_reader_t *reader) {
+    return reader->error;
+}
+
+int buffer_reader_position(buffer_reader_t *reader) {
+    return reader->pos;
+}
+
+int buffer_reader_remaining(buffer_reader_t *reader) {
+    return reader->length - reader->pos;
+}
+
+// Move past len bytes and return where they start, or NULL once there is an error
+static const unsigned char *buffer_reader_take(buffer_reader_t *reader, int len) {
+    if (reader->error) {
+        return NULL;
+    }
+    if (len < 0 || len > reader->length - reader->pos) {
+        reader->error = UTILS_ERR_BUFFER_TOO_SMALL;
+        return NULL;
+    }
+    const unsigned char *data = reader->data + reader->pos;
+    reader->pos += len;
+    return data;
+}
+
+uint8_t buffer_reader_u8(buffer_reader_t *reader) {
+    const unsigned char *data = buffer_reader_take(reader, 1);
+    return data ? data[0] : 0;
+}
+
+uint16_t buffer_reader_u16_be(buffer_reader_t *reader) {
+    const unsigned char *data = buffer_reader_take(reader, 2);
+    return data ? (data[0] << 8) | data[1] : 0;
+}
+
+uint16_t buffer_reader_u16_le(buffer_reader_t *reader) {
+    const unsigned char *data = buffer_reader_take(reader, 2);
+    return data ? data[0] | (data[1] << 8) : 0;
+}
+
+uint32_t buffer_reader_u32_be(buffer_reader_t *reader) {
+    const unsigned char *data = buffer_reader_take(reader, 4);
+    return data ? ((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3] : 0;
+}
+
+uint32_t buffer_reader_u32_le(buffer_reader_t *reader) {
+    const unsigned char *data = buffer_reader_take(reader, 4);
+    return data ? data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24) : 0;
+}
+
+uint64_t buffer_reader_u64_be(buffer_reader_t *reader) {
+    uint64_t high = buffer_reader_u32_be(reader);
+    return (high << 32) | buffer_reader_u32_be(reader);
+}
+
+uint64_t buffer_reader_u64_le(buffer_reader_t *reader) {
+    uint64_t low = buffer_reader_u32_le(reader);
+    return low | ((uint64_t)buffer_reader_u32_le(reader) << 32);
+}
+
+uint64_t buffer_reader_varint(buffer_reader_t *reader) {
+    uint64_t value = 0;
+    int pos = reader->pos;
+    if (reader->error) {
+        return 0;
+    }
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos == reader->length) {
+            reader->error = UTILS_ERR_BUFFER_TOO_SMALL;
+            return 0;
+        }
+        unsigned char byte = reader->data[pos++];
+        // The tenth byte only has room for the top bit
+        if (shift == 63 && byte > 1) {
+            break;
+        }
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            reader->pos = pos;
+            return value;
+        }
+    }
+    reader->error = UTILS_ERR_INVALID_DATA;
+    return 0;
+}
+
+void buffer_reader_skip(buffer_reader_t *reader, int len) {
+    buffer_reader_take(reader, len);
+}
+
+const unsigned char *buffer_reader_bytes(buffer_reader_t *reader, int len) {
+    return buffer_reader_take(reader, len);
+}
+
+const unsigned char *buffer_reader_field(buffer_reader_t *reader, int prefix, int *len) {
+    uint64_t length;
+    if (prefix == 1) {
+        length = buffer_reader_u8(reader);
+    }
+    else if (prefix == 2) {
+        length = buffer_reader_u16_be(reader);
+    }
+    else if (prefix == 4) {
+        length = buffer_reader_u32_be(reader);
+    }
+    else if (prefix == BUFFER_READER_PREFIX_VARINT) {
+        length = buffer_reader_varint(reader);
+    }
+    else {
+        if (!reader->error) {
+            reader->error = UTILS_ERR_NOT_SUPPORTED;
+        }
+        length = 0;
+    }
+    // Lengths past the end, including those that don't fit in an int, fail in buffer_reader_take
+    int field_length = length > (uint64_t)(reader->length - reader->pos) ? -1 : (int)length;
+    const unsigned char *data = buffer_reader_take(reader, field_length);
+    *len = data ? field_length : 0;
+    return data;
+}
+
+buffer_t buffer_reader_slice(buffer_reader_t *reader, int len) {
+    int offset = reader->pos;
+    buffer_t slice;
+    if (!reader->buffer && !reader->error) {
+        reader->error = UTILS_ERR_NOT_SUPPORTED;
+    }
+    if (!buffer_reader_take(reader, len)) {
+        return NULL;
+    }
+    if (!(slice = buffer_slice(reader->buffer, offset, len))) {
+        reader->error = UTILS_ERR_ALLOC_FAILED;
+    }
+    return slice;
+}
+
+int buffer_reader_mpi(buffer_reader_t *reader, int len, mbedtls_mpi *mpi) {
+    const unsigned char *data = buffer_reader_take(reader, len);
+    if (data && mbedtls_mpi_read_binary(mpi, data, len)) {
+        reader->error = UTILS_ERR_ALLOC_FAILED;
+    }
+    return reader->error;
+}
+
+/***********************************************************************************************************
+ * Buffer chain
+ ***********************************************************************************************************/
+// Size of the segments the chain allocates for copied data
+#define BUFFER_CHAIN_SEGMENT_SIZE   64
+#define BUFFER_CHAIN_MIN_CAPACITY   8
+
+struct _buffer_chain_segment {
+    buffer_t buffer;
+    // Segment created by the chain for copied data, which can be appended to
+    bool owned;
+};
+
+// Segments are referenced from an array rather than a linked list, which saves one
+// allocation per segment
+struct _buffer_chain {
+    struct _buffer_chain_segment *segments;
+    int count;
+    int capacity;
+};
+
+static int buffer_chain_push(buffer_chain_t chain, buffer_t buffer, bool owned) {
+    if (chain->count == chain->capacity) {
+        struct _buffer_chain_segment *segments;
+        int capacity = chain->capacity ? chain->capacity * 2 : BUFFER_CHAIN_MIN_CAPACITY;
+        if (!(segments = (struct _buffer_chain_segment *)realloc(chain->segments, sizeof(struct _buffer_chain_segment) * capacity))) {
+            return UTILS_ERR_ALLOC_FAILED;
+        }
+        chain->segments = segments;
+        chain->capacity = capacity;
+    }
+    chain->segments[chain->count].buffer = buffer;
+    chain->segments[chain->count].owned = owned;
+    chain->count++;
+    return UTILS_ERR_OK;
+}
+
+// Return a segment owned by the chain at the end of it, with room for len bytes
+static buffer_t buffer_chain_tail(buffer_chain_t chain, int len) {
+    buffer_t buffer;
+    if (chain->count && chain->segments[chain->count - 1].owned) {
+        return chain->segments[chain->count - 1].buffer;
+    }
+    if (!(buffer = buffer_new((len > BUFFER_CHAIN_SEGMENT_SIZE) ? len : BUFFER_CHAIN_SEGMENT_SIZE))) {
+        return NULL;
+    }
+    if (buffer_chain_push(chain, buffer, true) != UTILS_ERR_OK) {
+        buffer_free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+buffer_chain_t buffer_chain_new(void) {
+    buffer_chain_t chain;
+    if (!(chain = (buffer_chain_t)malloc(sizeof(struct _buffer_chain)))) {
+        errno = UTILS_ERR_ALLOC_FAILED;
+        return NULL;
+    }
+    memset(chain, 0, sizeof(struct _buffer_chain));
+    return chain;
+}
+
+void buffer_chain_free(void *c) {
+    buffer_chain_t chain = (buffer_chain_t)c;
+    if (chain) {
+        buffer_chain_reset(chain);
+        free(chain->segments);
+        free(c);
+    }
+}
+
+void buffer_chain_reset(buffer_chain_t chain) {
+    for (int i = 0; i < chain->count; i++) {
+        buffer_free(chain->segments[i].buffer);
+    }
+    chain->count = 0;
+}
+
+int buffer_chain_get_length(buffer_chain_t chain) {
+    int length = 0;
+    for (int i = 0; i < chain->count; i++) {
+        length += buffer_get_length(chain->segments[i].buffer);
+    }
+    return length;
+}
+
+int buffer_chain_segment_count(buffer_chain_t chain) {
+    return chain->count;
+}
+
+int buffer_chain_append(buffer_chain_t chain, const unsigned char *data, int len) {
+    buffer_t buffer;
+    if (!(buffer = buffer_chain_tail(chain, len))) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    return buffer_append(buffer, data, len);
+}
+
+int buffer_chain_append_string(buffer_chain_t chain, const char *data) {
+    return buffer_chain_append(chain, (const unsigned char *)data, strlen(data));
+}
+
+int buffer_chain_append_buffer(buffer_chain_t chain, buffer_t buffer) {
+    int ret;
+    buffer->refcount++;
+    if ((ret = buffer_chain_push(chain, buffer, false)) != UTILS_ERR_OK) {
+        buffer->refcount--;
+    }
+    return ret;
+}
+
+int buffer_chain_append_mpi(buffer_chain_t chain, mbedtls_mpi *data) {
+    buffer_t buffer;
+    if (!(buffer = buffer_chain_tail(chain, mbedtls_mpi_size(data)))) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    return buffer_append_mpi(buffer, data);
+}
+
+void buffer_chain_iterator_init(buffer_chain_iterator_t *iterator, buffer_chain_t chain) {
+    iterator->chain = chain;
+    iterator->index = 0;
+}
+
+bool buffer_chain_next_segment(buffer_chain_iterator_t *iterator, buffer_segment_t *segment) {
+    if (iterator->index >= iterator->chain->count) {
+        return false;
+    }
+    buffer_t buffer = iterator->chain->segments[iterator->index++].buffer;
+    segment->data = buffer_get_data(buffer);
+    segment->length = buffer_get_length(buffer);
+    return true;
+}
+
+int buffer_chain_get_segments(buffer_chain_t chain, buffer_segment_t *segments, int max) {
+    int count = (chain->count < max) ? chain->count : max;
+    for (int i = 0; i < count; i++) {
+        segments[i].data = buffer_get_data(chain->segments[i].buffer);
+        segments[i].length = buffer_get_length(chain->segments[i].buffer);
+    }
+    return count;
+}
+
+buffer_t buffer_chain_flatten(buffer_chain_t chain) {
+    buffer_t buffer;
+    if (!(buffer = buffer_new(buffer_chain_get_length(chain)))) {
+        return NULL;
+    }
+    for (int i = 0; i < chain->count; i++) {
+        buffer_append_buffer(buffer, chain->segments[i].buffer);
+    }
+    return buffer;
+}
+
+/***********************************************************************************************************
+ * Ring buffer
+ ***********************************************************************************************************/
+#define RING_BUFFER_MIN_CAPACITY    16
+
+// The positions run freely and are masked on access, so the ring can be completely full
+struct _ring_buffer {
+    // Written by the producer only
+    atomic_uint head;
+    char head_padding[COLLECTIONS_CACHE_LINE - sizeof(atomic_uint)];
+    // Written by the consumer only
+    atomic_uint tail;
+    char tail_padding[COLLECTIONS_CACHE_LINE - sizeof(atomic_uint)];
+    unsigned int mask;
+    unsigned char data[];
+};
+
+ring_buffer_t ring_buffer_new(int capacity) {
+    ring_buffer_t ring;
+    unsigned int size = RING_BUFFER_MIN_CAPACITY;
+    while (size < (unsigned int)capacity) {
+        size <<= 1;
+    }
+    if (!(ring = (ring_buffer_t)malloc(sizeof(struct _ring_buffer) + size))) {
+        errno = UTILS_ERR_ALLOC_FAILED;
+        return NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->mask = size - 1;
+    return ring;
+}
+
+void ring_buffer_free(void *ring) {
+    free(ring);
+}
+
+int ring_buffer_capacity(ring_buffer_t ring) {
+    return ring->mask + 1;
+}
+
+int IRAM_ATTR ring_buffer_get_length(ring_buffer_t ring) {
+    return atomic_load_explicit(&ring->head, memory_order_acquire) - atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+unsigned char * IRAM_ATTR ring_buffer_reserve(ring_buffer_t ring, int *len) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    unsigned int offset = head & ring->mask;
+    unsigned int free_len = ring->mask + 1 - (head - tail);
+    unsigned int to_end = ring->mask + 1 - offset;
+    *len = (free_len < to_end) ? free_len : to_end;
+    return ring->data + offset;
+}
+
+void IRAM_ATTR ring_buffer_commit(ring_buffer_t ring, int len) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + len, memory_order_release);
+}
+
+int IRAM_ATTR ring_buffer_write(ring_buffer_t ring, const unsigned char *data, int len) {
+    int written = 0;
+    // At most two pieces, before and after the end of the storage
+    while (written < len) {
+        int available;
+        unsigned char *region = ring_buffer_reserve(ring, &available);
+        if (!available) {
+            break;
+        }
+        int count = (len - written < available) ? len - written : available;
+        memcpy(region, data + written, count);
+        ring_buffer_commit(ring, count);
+        written += count;
+    }
+    return written;
+}
+
+const unsigned char *ring_buffer_peek(ring_buffer_t ring, int *len) {
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned int offset = tail & ring->mask;
+    unsigned int used = head - tail;
+    unsigned int to_end = ring->mask + 1 - offset;
+    *len = (used < to_end) ? used : to_end;
+    return ring->data + offset;
+}
+
+void ring_buffer_consume(ring_buffer_t ring, int len) {
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+}
+
+int ring_buffer_read(ring_buffer_t ring, unsigned char *data, int len) {
+    int read = 0;
+    while (read < len) {
+        int available;
+        const unsigned char *region = ring_buffer_peek(ring, &available);
+        if (!available) {
+            break;
+        }
+        int count = (len - read < available) ? len - read : available;
+        memcpy(data + read, region, count);
+        ring_buffer_consume(ring, count);
+        read += count;
     }
+    return read;
 }
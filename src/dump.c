@@ -27,43 +27,401 @@
  */
 
 #include "esp32-utils/dump.h"
+#include <stdatomic.h>
+#include "freertos/task.h"
 
-void dump_data(const void* data, size_t size, const char *description) {
-	char ascii[17];
-	size_t i, j;
-	ascii[16] = '\0';
+#define DUMP_BYTES_PER_LINE         16
+// Hex column, separator, ASCII column and line end
+#define DUMP_HEX_SIZE               50
+#define DUMP_LINE_SIZE              (DUMP_HEX_SIZE + 3 + DUMP_BYTES_PER_LINE + 2)
+// Longest line of the text dumps
+#define DUMP_TEXT_LINE_SIZE         80
+// Descriptions tracked at once by the rate limit, a power of two
+#define DUMP_RATE_ENTRIES           16
+// Entries looked at for a description, from the one its hash points to
+#define DUMP_RATE_PROBES            4
+// Producers and the worker update different cache lines
+#define DUMP_CACHE_LINE             64
+
+#if (UTILS_DUMP_ASYNC_SLOTS & (UTILS_DUMP_ASYNC_SLOTS - 1))
+#error "UTILS_DUMP_ASYNC_SLOTS must be a power of two"
+#endif
+_Static_assert(UTILS_DUMP_BLOCK_SIZE >= DUMP_LINE_SIZE, "UTILS_DUMP_BLOCK_SIZE must hold a formatted line");
+
+// Lines are formatted in a block on the stack, which is written out when full
+typedef struct {
+	dump_sink *sink;
+	void *context;
+	size_t len;
+	char block[UTILS_DUMP_BLOCK_SIZE];
+} dump_output_t;
+
+static const char dump_hex_digits[] = "0123456789ABCDEF";
+
+static dump_sink *dump_default_sink = dump_sink_file;
+static void *dump_default_context = NULL;
+
+// A queued dump. The sequence tells whose turn it is: equal to the position for the producer that
+// claims it, one more once filled for the worker, and a lap later when free again
+typedef struct {
+	atomic_uint sequence;
+	// Size of the dumped data, len of which were kept. 0 for a NULL dump
+	unsigned int size;
+	unsigned int len;
+	bool has_description;
+	char description[UTILS_DUMP_ASYNC_DESCRIPTION_SIZE];
+	unsigned char data[UTILS_DUMP_ASYNC_SLOT_SIZE];
+} dump_slot_t;
+
+typedef struct {
+	atomic_uint hash;
+	// Tick the current period started
+	atomic_uint start;
+	atomic_uint count;
+} dump_rate_t;
+
+typedef struct {
+	// Claimed by the producers
+	atomic_uint head;
+	char head_padding[DUMP_CACHE_LINE - sizeof(atomic_uint)];
+	// Advanced by the worker
+	atomic_uint tail;
+	char tail_padding[DUMP_CACHE_LINE - sizeof(atomic_uint)];
+	atomic_uint dropped;
+	atomic_uint rate_limited;
+	atomic_uint truncated;
+	atomic_bool running;
+	atomic_bool stopped;
+	dump_rate_t rates[DUMP_RATE_ENTRIES];
+	dump_slot_t slots[UTILS_DUMP_ASYNC_SLOTS];
+} dump_async_t;
+
+static _Atomic(dump_async_t *) dump_async = NULL;
+static atomic_int dump_rate_count = 0;
+// In ticks
+static atomic_uint dump_rate_period = 0;
+
+static void dump_flush(dump_output_t *output) {
+	if (output->len) {
+		output->sink(output->context, output->block, output->len);
+		output->len = 0;
+	}
+}
+
+static void dump_write(dump_output_t *output, const char *data, size_t len) {
+	if (output->len + len > sizeof(output->block)) {
+		dump_flush(output);
+		if (len > sizeof(output->block)) {
+			output->sink(output->context, data, len);
+			return;
+		}
+	}
+	memcpy(output->block + output->len, data, len);
+	output->len += len;
+}
+
+// Format up to DUMP_BYTES_PER_LINE bytes
+static void dump_line(dump_output_t *output, const unsigned char *bytes, size_t count) {
+	if (output->len + DUMP_LINE_SIZE > sizeof(output->block)) {
+		dump_flush(output);
+	}
+	char *line = output->block + output->len;
+	char *ascii = line + DUMP_HEX_SIZE + 3;
+	memset(line, ' ', DUMP_HEX_SIZE);
+	for (size_t i = 0; i < count; i++) {
+		// An extra space separates the two halves
+		char *hex = line + i * 3 + (i >= DUMP_BYTES_PER_LINE / 2);
+		hex[0] = dump_hex_digits[bytes[i] >> 4];
+		hex[1] = dump_hex_digits[bytes[i] & 0x0F];
+		ascii[i] = (bytes[i] >= ' ' && bytes[i] <= '~') ? bytes[i] : '.';
+	}
+	memcpy(line + DUMP_HEX_SIZE, "|  ", 3);
+	ascii[count] = ' ';
+	ascii[count + 1] = '\n';
+	output->len += DUMP_HEX_SIZE + 3 + count + 2;
+}
+
+static void dump_begin(dump_output_t *output, dump_sink *sink, void *context, const char *description) {
+	output->sink = sink;
+	output->context = context;
+	output->len = 0;
+	if (description) {
+		dump_write(output, description, strlen(description));
+		dump_write(output, "\n", 1);
+	}
+}
+
+static void dump_end(dump_output_t *output, const char *description) {
 	if (description) {
-		printf("%s\n", description);
+		dump_write(output, "End\n", 4);
 	}
+	dump_flush(output);
+}
+
+void dump_sink_file(void *context, const char *data, size_t len) {
+	fwrite(data, 1, len, context ? (FILE *)context : stdout);
+}
+
+void dump_sink_buffer(void *context, const char *data, size_t len) {
+	buffer_append((buffer_t)context, (const unsigned char *)data, len);
+}
+
+void dump_set_sink(dump_sink *sink, void *context) {
+	dump_default_sink = sink ? sink : dump_sink_file;
+	dump_default_context = sink ? context : NULL;
+}
+
+// Dump len bytes of data, out of size when it was truncated
+static void dump_bytes(dump_sink *sink, void *context, const void *data, size_t len, size_t size, const char *description) {
+	dump_output_t output;
+	dump_begin(&output, sink, context, description);
 	if (!data || !size) {
-		printf("NULL\n");
+		dump_write(&output, "NULL\n", 5);
+		dump_flush(&output);
 		return;
 	}
-	for (i = 0; i < size; ++i) {
-		printf("%02X ", ((unsigned char*)data)[i]);
-		if (((unsigned char*)data)[i] >= ' ' && ((unsigned char*)data)[i] <= '~') {
-			ascii[i % 16] = ((unsigned char*)data)[i];
-		} else {
-			ascii[i % 16] = '.';
+	for (size_t i = 0; i < len; i += DUMP_BYTES_PER_LINE) {
+		size_t count = len - i;
+		dump_line(&output, (const unsigned char *)data + i, (count < DUMP_BYTES_PER_LINE) ? count : DUMP_BYTES_PER_LINE);
+	}
+	if (len < size) {
+		char line[DUMP_TEXT_LINE_SIZE];
+		int line_len = snprintf(line, sizeof(line), "... %u more bytes\n", (unsigned int)(size - len));
+		dump_write(&output, line, line_len);
+	}
+	dump_end(&output, description);
+}
+
+void dump_data_to(dump_sink *sink, void *context, const void *data, size_t size, const char *description) {
+	dump_bytes(sink, context, data, size, size, description);
+}
+
+// Hash of the description, never 0 which marks unused rate entries
+static unsigned int dump_description_hash(const char *description) {
+	unsigned int hash = 2166136261u;
+	if (description) {
+		for (const unsigned char *c = (const unsigned char *)description; *c; c++) {
+			hash = (hash ^ *c) * 16777619u;
 		}
-		if ((i+1) % 8 == 0 || i+1 == size) {
-			printf(" ");
-			if ((i+1) % 16 == 0) {
-				printf("|  %s \n", ascii);
-			} else if (i+1 == size) {
-				ascii[(i+1) % 16] = '\0';
-				if ((i+1) % 16 <= 8) {
-					printf(" ");
-				}
-				for (j = (i+1) % 16; j < 16; ++j) {
-					printf("   ");
-				}
-				printf("|  %s \n", ascii);
-			}
+	}
+	return hash ? hash : 1;
+}
+
+static bool dump_rate_expired(dump_rate_t *rate, TickType_t now, TickType_t period) {
+	return (TickType_t)(now - atomic_load_explicit(&rate->start, memory_order_relaxed)) >= period;
+}
+
+static bool dump_async_allowed(dump_async_t *async, const char *description) {
+	int limit = atomic_load_explicit(&dump_rate_count, memory_order_relaxed);
+	if (!limit) {
+		return true;
+	}
+	TickType_t period = atomic_load_explicit(&dump_rate_period, memory_order_relaxed);
+	TickType_t now = xTaskGetTickCount();
+	unsigned int hash = dump_description_hash(description);
+	// Find the description near its home entry, or an unused entry to take over
+	dump_rate_t *rate = NULL;
+	dump_rate_t *unused = NULL;
+	for (int i = 0; i < DUMP_RATE_PROBES && !rate; i++) {
+		dump_rate_t *entry = &async->rates[(hash + i) & (DUMP_RATE_ENTRIES - 1)];
+		unsigned int entry_hash = atomic_load_explicit(&entry->hash, memory_order_relaxed);
+		if (entry_hash == hash) {
+			rate = entry;
+		}
+		else if (!unused && (!entry_hash || dump_rate_expired(entry, now, period))) {
+			unused = entry;
+		}
+	}
+	// Racing producers may both start a period, which only lets a few more dumps through
+	if (rate && dump_rate_expired(rate, now, period)) {
+		atomic_store_explicit(&rate->start, now, memory_order_relaxed);
+		atomic_store_explicit(&rate->count, 0, memory_order_relaxed);
+	}
+	else if (!rate && unused) {
+		rate = unused;
+		atomic_store_explicit(&rate->hash, hash, memory_order_relaxed);
+		atomic_store_explicit(&rate->start, now, memory_order_relaxed);
+		atomic_store_explicit(&rate->count, 0, memory_order_relaxed);
+	}
+	else if (!rate) {
+		// All taken, share the budget of the home entry
+		rate = &async->rates[hash & (DUMP_RATE_ENTRIES - 1)];
+	}
+	return (int)atomic_fetch_add_explicit(&rate->count, 1, memory_order_relaxed) < limit;
+}
+
+// Claim a slot for a dump of size bytes, or return NULL when it is dropped. Fill slot->data with
+// slot->len bytes, then pass it to dump_async_commit
+static dump_slot_t *dump_async_claim(dump_async_t *async, size_t size, const char *description) {
+	if (!dump_async_allowed(async, description)) {
+		atomic_fetch_add_explicit(&async->rate_limited, 1, memory_order_relaxed);
+		return NULL;
+	}
+	dump_slot_t *slot;
+	unsigned int head = atomic_load_explicit(&async->head, memory_order_relaxed);
+	for (;;) {
+		slot = &async->slots[head & (UTILS_DUMP_ASYNC_SLOTS - 1)];
+		int lag = (int)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - head);
+		if (lag < 0) {
+			// The worker hasn't freed it yet, the queue is full
+			atomic_fetch_add_explicit(&async->dropped, 1, memory_order_relaxed);
+			return NULL;
+		}
+		if (!lag && atomic_compare_exchange_weak_explicit(&async->head, &head, head + 1,
+			memory_order_relaxed, memory_order_relaxed)) {
+			break;
+		}
+		if (lag) {
+			head = atomic_load_explicit(&async->head, memory_order_relaxed);
 		}
 	}
+	slot->size = size;
+	slot->len = (size < UTILS_DUMP_ASYNC_SLOT_SIZE) ? size : UTILS_DUMP_ASYNC_SLOT_SIZE;
+	if (slot->len < size) {
+		atomic_fetch_add_explicit(&async->truncated, 1, memory_order_relaxed);
+	}
+	slot->has_description = description != NULL;
 	if (description) {
-		printf("End\n");
+		strncpy(slot->description, description, sizeof(slot->description) - 1);
+		slot->description[sizeof(slot->description) - 1] = '\0';
+	}
+	return slot;
+}
+
+static void dump_async_commit(dump_slot_t *slot) {
+	unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+	atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_release);
+}
+
+// Write out the filled slots, return how many
+static int dump_async_drain(dump_async_t *async) {
+	int count = 0;
+	unsigned int tail = atomic_load_explicit(&async->tail, memory_order_relaxed);
+	for (;; tail++, count++) {
+		dump_slot_t *slot = &async->slots[tail & (UTILS_DUMP_ASYNC_SLOTS - 1)];
+		if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != tail + 1) {
+			break;
+		}
+		dump_bytes(dump_default_sink, dump_default_context, slot->data, slot->len, slot->size,
+			slot->has_description ? slot->description : NULL);
+		atomic_store_explicit(&slot->sequence, tail + UTILS_DUMP_ASYNC_SLOTS, memory_order_release);
+		atomic_store_explicit(&async->tail, tail + 1, memory_order_release);
+	}
+	return count;
+}
+
+// Tell, among the dumps, how many were lost since the last report
+static void dump_async_report(dump_async_t *async, unsigned int *reported_dropped, unsigned int *reported_rate_limited) {
+	unsigned int dropped = atomic_load_explicit(&async->dropped, memory_order_relaxed);
+	unsigned int rate_limited = atomic_load_explicit(&async->rate_limited, memory_order_relaxed);
+	if (dropped != *reported_dropped || rate_limited != *reported_rate_limited) {
+		char line[DUMP_TEXT_LINE_SIZE];
+		int len = snprintf(line, sizeof(line), "Dumps lost: %u dropped, %u rate limited\n",
+			dropped - *reported_dropped, rate_limited - *reported_rate_limited);
+		dump_default_sink(dump_default_context, line, len);
+		*reported_dropped = dropped;
+		*reported_rate_limited = rate_limited;
+	}
+}
+
+static void dump_async_task(void *parameters) {
+	dump_async_t *async = (dump_async_t *)parameters;
+	unsigned int reported_dropped = 0;
+	unsigned int reported_rate_limited = 0;
+	TickType_t poll = UTILS_DUMP_ASYNC_POLL_MS / portTICK_PERIOD_MS;
+	while (atomic_load_explicit(&async->running, memory_order_acquire)) {
+		if (dump_async_drain(async)) {
+			continue;
+		}
+		dump_async_report(async, &reported_dropped, &reported_rate_limited);
+		vTaskDelay(poll ? poll : 1);
+	}
+	dump_async_drain(async);
+	dump_async_report(async, &reported_dropped, &reported_rate_limited);
+	atomic_store_explicit(&async->stopped, true, memory_order_release);
+	vTaskDelete(NULL);
+}
+
+int dump_async_start(void) {
+	dump_async_t *async;
+	if (atomic_load(&dump_async)) {
+		return UTILS_ERR_IN_USE;
+	}
+	if (!(async = (dump_async_t *)calloc(1, sizeof(dump_async_t)))) {
+		return UTILS_ERR_ALLOC_FAILED;
+	}
+	for (unsigned int i = 0; i < UTILS_DUMP_ASYNC_SLOTS; i++) {
+		atomic_init(&async->slots[i].sequence, i);
+	}
+	atomic_init(&async->running, true);
+	if (xTaskCreate(dump_async_task, "dump_async", UTILS_DUMP_ASYNC_STACK_SIZE, async, UTILS_DUMP_ASYNC_PRIORITY, NULL) != pdPASS) {
+		free(async);
+		return UTILS_ERR_ALLOC_FAILED;
+	}
+	atomic_store_explicit(&dump_async, async, memory_order_release);
+	return UTILS_ERR_OK;
+}
+
+void dump_async_stop(void) {
+	dump_async_t *async = atomic_exchange(&dump_async, NULL);
+	if (async) {
+		atomic_store_explicit(&async->running, false, memory_order_release);
+		while (!atomic_load_explicit(&async->stopped, memory_order_acquire)) {
+			vTaskDelay(1);
+		}
+		free(async);
+	}
+}
+
+bool dump_async_running(void) {
+	return atomic_load_explicit(&dump_async, memory_order_relaxed) != NULL;
+}
+
+void dump_async_flush(void) {
+	dump_async_t *async = atomic_load_explicit(&dump_async, memory_order_acquire);
+	if (async) {
+		unsigned int head = atomic_load_explicit(&async->head, memory_order_acquire);
+		while ((int)(atomic_load_explicit(&async->tail, memory_order_acquire) - head) < 0) {
+			vTaskDelay(1);
+		}
+	}
+}
+
+void dump_async_get_stats(dump_async_stats_t *stats) {
+	dump_async_t *async = atomic_load_explicit(&dump_async, memory_order_acquire);
+	memset(stats, 0, sizeof(dump_async_stats_t));
+	if (async) {
+		stats->queued = atomic_load_explicit(&async->head, memory_order_relaxed);
+		stats->written = atomic_load_explicit(&async->tail, memory_order_relaxed);
+		stats->dropped = atomic_load_explicit(&async->dropped, memory_order_relaxed);
+		stats->rate_limited = atomic_load_explicit(&async->rate_limited, memory_order_relaxed);
+		stats->truncated = atomic_load_explicit(&async->truncated, memory_order_relaxed);
+	}
+}
+
+int dump_async_set_rate_limit(int count, int period_ms) {
+	if (count < 0 || (count && period_ms <= 0)) {
+		return UTILS_ERR_OUT_OF_RANGE;
+	}
+	// Periods shorter than a tick last one tick rather than none
+	unsigned int period = (period_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+	atomic_store_explicit(&dump_rate_period, period, memory_order_relaxed);
+	atomic_store_explicit(&dump_rate_count, count, memory_order_relaxed);
+	return UTILS_ERR_OK;
+}
+
+void dump_data(const void* data, size_t size, const char *description) {
+	dump_async_t *async = atomic_load_explicit(&dump_async, memory_order_acquire);
+	if (!async) {
+		dump_data_to(dump_default_sink, dump_default_context, data, size, description);
+		return;
+	}
+	dump_slot_t *slot;
+	if ((slot = dump_async_claim(async, data ? size : 0, description))) {
+		if (slot->len) {
+			memcpy(slot->data, data, slot->len);
+		}
+		dump_async_commit(slot);
 	}
 }
 
@@ -75,20 +433,74 @@ void dump_string(const char *string, const char *description) {
 	dump_data(string, size, description);
 }
 
+// Read count bytes of big_number, size bytes long, from offset counting from the most significant.
+// mbedtls 3 makes the limbs private, so the bits are read through the API
+static void dump_big_number_bytes(const mbedtls_mpi *big_number, size_t size, size_t offset, unsigned char *bytes, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		size_t bit = (size - 1 - (offset + i)) * 8;
+		unsigned char byte = 0;
+		for (int j = 7; j >= 0; j--) {
+			byte = (unsigned char)(byte << 1 | mbedtls_mpi_get_bit(big_number, bit + j));
+		}
+		bytes[i] = byte;
+	}
+}
+
 void dump_big_number(mbedtls_mpi *big_number, const char *description) {
-	if (!big_number) {
+	size_t size = big_number ? mbedtls_mpi_size(big_number) : 0;
+	if (!size) {
 		dump_data(NULL, 0, description);
 		return;
 	}
-	unsigned char *bytes_bn; int len_bn;
-	len_bn   = mbedtls_mpi_size(big_number);
-	bytes_bn = malloc(len_bn);
-	mbedtls_mpi_write_binary(big_number, bytes_bn, len_bn);
-	dump_data(bytes_bn, len_bn, description);
-	free(bytes_bn);
+	dump_async_t *async = atomic_load_explicit(&dump_async, memory_order_acquire);
+	if (async) {
+		dump_slot_t *slot;
+		if ((slot = dump_async_claim(async, size, description))) {
+			// Keep the most significant bytes
+			if (slot->len == size) {
+				mbedtls_mpi_write_binary(big_number, slot->data, size);
+			}
+			else {
+				dump_big_number_bytes(big_number, size, 0, slot->data, slot->len);
+			}
+			dump_async_commit(slot);
+		}
+		return;
+	}
+	dump_output_t output;
+	unsigned char bytes[DUMP_BYTES_PER_LINE];
+	dump_begin(&output, dump_default_sink, dump_default_context, description);
+	// A line of bytes at a time, most significant first, so that nothing is allocated
+	for (size_t i = 0; i < size; i += DUMP_BYTES_PER_LINE) {
+		size_t count = (size - i < DUMP_BYTES_PER_LINE) ? size - i : DUMP_BYTES_PER_LINE;
+		dump_big_number_bytes(big_number, size, i, bytes, count);
+		dump_line(&output, bytes, count);
+	}
+	dump_end(&output, description);
+}
+
+void dump_stats(const utils_stats_t *stats, const char *description) {
+	dump_output_t output;
+	char line[DUMP_TEXT_LINE_SIZE];
+	int len;
+	dump_begin(&output, dump_default_sink, dump_default_context, description);
+	len = snprintf(line, sizeof(line), "%-8s %10s %10s %10s %10s %10s\n", "", "objects", "bytes", "peak", "allocs", "reallocs");
+	dump_write(&output, line, len);
+	for (int i = 0; i < UTILS_STATS_KINDS; i++) {
+		const utils_stats_counters_t *counters = &stats->kinds[i];
+		len = snprintf(line, sizeof(line), "%-8s %10d %10d %10d %10d %10d\n", utils_stats_kind_name(i),
+			counters->objects, counters->bytes, counters->peak_bytes, counters->allocs, counters->reallocs);
+		dump_write(&output, line, len);
+	}
+	dump_write(&output, "map probes", 10);
+	for (int i = 0; i < UTILS_STATS_PROBE_BUCKETS; i++) {
+		len = snprintf(line, sizeof(line), " %d%s:%d", i, (i == UTILS_STATS_PROBE_BUCKETS - 1) ? "+" : "", stats->map_probes[i]);
+		dump_write(&output, line, len);
+	}
+	dump_write(&output, "\n", 1);
+	dump_end(&output, description);
 }
 
 void dump_buffer(buffer_t buffer, const char *description) {
     dump_data(buffer_get_data(buffer), buffer_get_length(buffer), description);
 }
-
@@ -0,0 +1,401 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include "esp32-utils/frozen_map.h"
+#include <stdlib.h>
+#ifdef ESP_PLATFORM
+#include "esp_idf_version.h"
+// The partition mmap API got its own handle, memory type and munmap with the esp_partition
+// component in IDF 5.1. Before that, partitions are mapped and unmapped with spi_flash types
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#define FROZEN_MAP_MMAP_DATA        ESP_PARTITION_MMAP_DATA
+#define frozen_map_munmap(handle)   esp_partition_munmap(handle)
+typedef esp_partition_mmap_handle_t frozen_map_mmap_handle_t;
+#else
+#define FROZEN_MAP_MMAP_DATA        SPI_FLASH_MMAP_DATA
+#define frozen_map_munmap(handle)   spi_flash_munmap(handle)
+typedef spi_flash_mmap_handle_t frozen_map_mmap_handle_t;
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/***********************************************************************************************************
+ * Frozen map
+ ***********************************************************************************************************/
+// Blob layout, all integers are 32-bit little endian:
+//   header         magic, size of the blob, count, buckets, seed
+//   displacements  one per bucket. Negative: -1 - the slot of the only key of the bucket.
+//                  Otherwise the displacement that spreads the keys of the bucket to their slots
+//   slots          count entries of key offset, value offset, value length
+//   values         back to back
+//   keys           \0 terminated, the blob ends with the last one
+#define FROZEN_MAP_MAGIC            0x314d5a46
+#define FROZEN_MAP_HEADER_SIZE      20
+#define FROZEN_MAP_SLOT_SIZE        12
+// Average number of keys per bucket. More makes a smaller blob that takes longer to build
+#define FROZEN_MAP_BUCKET_LOAD      2
+// Displacements tried for a bucket before starting over with another seed
+#define FROZEN_MAP_MAX_DISPLACEMENT 0x100000
+#define FROZEN_MAP_MAX_SEEDS        16
+
+static uint32_t frozen_map_read32(const unsigned char *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void frozen_map_write32(unsigned char *data, uint32_t value) {
+    data[0] = (unsigned char)value;
+    data[1] = (unsigned char)(value >> 8);
+    data[2] = (unsigned char)(value >> 16);
+    data[3] = (unsigned char)(value >> 24);
+}
+
+static uint32_t frozen_map_hash(const char *key, uint32_t seed) {
+    // FNV-1a, seeded
+    uint32_t hash = 2166136261u ^ seed;
+    for (; *key; key++) {
+        hash = (hash ^ (unsigned char)*key) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t frozen_map_slot(uint32_t hash, uint32_t displacement, uint32_t count) {
+    // murmur3 finalizer, so that each displacement gives unrelated slots
+    hash += displacement * 0x9e3779b9u;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash % count;
+}
+
+typedef struct {
+    uint32_t count;
+    uint32_t buckets;
+    uint32_t *hashes;
+    // Key indexes grouped by bucket, bucket b has order[start[b]..start[b + 1]]
+    uint32_t *order;
+    uint32_t *start;
+    int32_t *displacements;
+    // Key index in each slot, or -1
+    int32_t *slots;
+} frozen_map_builder_t;
+
+// Find a displacement for each bucket, largest buckets first. Fail if some bucket has none
+static int frozen_map_place(frozen_map_builder_t *builder, array_t keys, uint32_t seed) {
+    uint32_t count = builder->count;
+    uint32_t buckets = builder->buckets;
+    uint32_t largest = 0;
+    memset(builder->start, 0, sizeof(uint32_t) * (buckets + 1));
+    for (uint32_t i = 0; i < count; i++) {
+        builder->hashes[i] = frozen_map_hash((const char *)array_at(keys, i), seed);
+        builder->start[builder->hashes[i] % buckets + 1]++;
+    }
+    for (uint32_t b = 0; b < buckets; b++) {
+        if (builder->start[b + 1] > largest) {
+            largest = builder->start[b + 1];
+        }
+        builder->start[b + 1] += builder->start[b];
+    }
+    // Counting sort, start[b] ends up where bucket b + 1 starts
+    for (uint32_t i = 0; i < count; i++) {
+        builder->order[builder->start[builder->hashes[i] % buckets]++] = i;
+    }
+    memmove(builder->start + 1, builder->start, sizeof(uint32_t) * buckets);
+    builder->start[0] = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        builder->slots[i] = -1;
+    }
+    for (uint32_t b = 0; b < buckets; b++) {
+        builder->displacements[b] = 0;
+    }
+    for (uint32_t size = largest; size > 1; size--) {
+        for (uint32_t b = 0; b < buckets; b++) {
+            const uint32_t *members = builder->order + builder->start[b];
+            if (builder->start[b + 1] - builder->start[b] != size) {
+                continue;
+            }
+            uint32_t displacement = 0;
+            for (; displacement < FROZEN_MAP_MAX_DISPLACEMENT; displacement++) {
+                uint32_t placed = 0;
+                for (; placed < size; placed++) {
+                    uint32_t slot = frozen_map_slot(builder->hashes[members[placed]], displacement, count);
+                    if (builder->slots[slot] >= 0) {
+                        break;
+                    }
+                    // Claimed now so that members of the same bucket don't collide, undone below
+                    builder->slots[slot] = members[placed];
+                }
+                if (placed == size) {
+                    break;
+                }
+                while (placed--) {
+                    builder->slots[frozen_map_slot(builder->hashes[members[placed]], displacement, count)] = -1;
+                }
+            }
+            if (displacement == FROZEN_MAP_MAX_DISPLACEMENT) {
+                return UTILS_ERR_NOT_SUPPORTED;
+            }
+            builder->displacements[b] = displacement;
+        }
+    }
+    // Keys alone in their bucket take the slots left, directly
+    uint32_t free_slot = 0;
+    for (uint32_t b = 0; b < buckets; b++) {
+        if (builder->start[b + 1] - builder->start[b] == 1) {
+            while (builder->slots[free_slot] >= 0) {
+                free_slot++;
+            }
+            builder->slots[free_slot] = builder->order[builder->start[b]];
+            builder->displacements[b] = -1 - (int32_t)free_slot;
+        }
+    }
+    return UTILS_ERR_OK;
+}
+
+static int frozen_map_write(frozen_map_builder_t *builder, array_t keys, array_t values, uint32_t seed, buffer_t out) {
+    uint32_t count = builder->count;
+    uint32_t buckets = builder->buckets;
+    uint64_t tables = FROZEN_MAP_HEADER_SIZE + (uint64_t)buckets * 4 + (uint64_t)count * FROZEN_MAP_SLOT_SIZE;
+    uint64_t size = tables;
+    for (uint32_t i = 0; i < count; i++) {
+        size += buffer_get_length((buffer_t)array_at(values, i)) + strlen((const char *)array_at(keys, i)) + 1;
+    }
+    if (size > INT32_MAX) {
+        return UTILS_ERR_NOT_SUPPORTED;
+    }
+    int ret;
+    if ((ret = buffer_ensure_available(out, (int)size))) {
+        return ret;
+    }
+    unsigned char word[4];
+    uint32_t header[5] = { FROZEN_MAP_MAGIC, (uint32_t)size, count, buckets, seed };
+    for (int i = 0; i < 5; i++) {
+        frozen_map_write32(word, header[i]);
+        buffer_append(out, word, 4);
+    }
+    for (uint32_t b = 0; b < buckets; b++) {
+        frozen_map_write32(word, (uint32_t)builder->displacements[b]);
+        buffer_append(out, word, 4);
+    }
+    // Values then keys, in slot order
+    uint32_t value_offset = (uint32_t)tables;
+    uint32_t key_offset = (uint32_t)size;
+    for (uint32_t i = 0; i < count; i++) {
+        key_offset -= strlen((const char *)array_at(keys, i)) + 1;
+    }
+    for (uint32_t slot = 0; slot < count; slot++) {
+        int index = builder->slots[slot];
+        uint32_t value_length = buffer_get_length((buffer_t)array_at(values, index));
+        uint32_t entry[3] = { key_offset, value_offset, value_length };
+        for (int i = 0; i < 3; i++) {
+            frozen_map_write32(word, entry[i]);
+            buffer_append(out, word, 4);
+        }
+        key_offset += strlen((const char *)array_at(keys, index)) + 1;
+        value_offset += value_length;
+    }
+    for (uint32_t slot = 0; slot < count; slot++) {
+        buffer_append_buffer(out, (buffer_t)array_at(values, builder->slots[slot]));
+    }
+    for (uint32_t slot = 0; slot < count; slot++) {
+        const char *key = (const char *)array_at(keys, builder->slots[slot]);
+        buffer_append(out, (const unsigned char *)key, strlen(key) + 1);
+    }
+    return UTILS_ERR_OK;
+}
+
+int frozen_map_freeze(map_t map, buffer_t out) {
+    frozen_map_builder_t builder = { 0 };
+    array_t keys = map_keys(map);
+    array_t values = map_values(map);
+    int ret = UTILS_ERR_ALLOC_FAILED;
+    if (map_get_free_callback(map) != buffer_free) {
+        return UTILS_ERR_NOT_SUPPORTED;
+    }
+    for (int i = 0; i < array_count(values); i++) {
+        if (!array_at(values, i)) {
+            return UTILS_ERR_INVALID_DATA;
+        }
+    }
+    builder.count = map_count(map);
+    builder.buckets = builder.count / FROZEN_MAP_BUCKET_LOAD;
+    if (!builder.buckets) {
+        builder.buckets = 1;
+    }
+    if (!(builder.hashes = (uint32_t *)malloc(sizeof(uint32_t) * (builder.count + 1))) ||
+        !(builder.order = (uint32_t *)malloc(sizeof(uint32_t) * (builder.count + 1))) ||
+        !(builder.start = (uint32_t *)malloc(sizeof(uint32_t) * (builder.buckets + 1))) ||
+        !(builder.displacements = (int32_t *)malloc(sizeof(int32_t) * builder.buckets)) ||
+        !(builder.slots = (int32_t *)malloc(sizeof(int32_t) * (builder.count + 1)))) {
+        goto cleanup;
+    }
+    uint32_t seed = 0;
+    for (; seed < FROZEN_MAP_MAX_SEEDS; seed++) {
+        if (!(ret = frozen_map_place(&builder, keys, seed))) {
+            break;
+        }
+    }
+    if (!ret) {
+        ret = frozen_map_write(&builder, keys, values, seed, out);
+    }
+cleanup:
+    free(builder.hashes);
+    free(builder.order);
+    free(builder.start);
+    free(builder.displacements);
+    free(builder.slots);
+    return ret;
+}
+
+int frozen_map_open(frozen_map_t *map, const void *data, int size) {
+    const unsigned char *blob = (const unsigned char *)data;
+    memset(map, 0, sizeof(frozen_map_t));
+    if (size < FROZEN_MAP_HEADER_SIZE || frozen_map_read32(blob) != FROZEN_MAP_MAGIC) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    uint32_t blob_size = frozen_map_read32(blob + 4);
+    uint32_t count = frozen_map_read32(blob + 8);
+    uint32_t buckets = frozen_map_read32(blob + 12);
+    uint64_t tables = FROZEN_MAP_HEADER_SIZE + (uint64_t)buckets * 4 + (uint64_t)count * FROZEN_MAP_SLOT_SIZE;
+    // Keys are compared in place, the last one must be terminated within the blob
+    if (blob_size > (uint32_t)size || tables > blob_size || !buckets || (count && blob[blob_size - 1])) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    map->data = blob;
+    map->size = blob_size;
+    map->count = count;
+    map->buckets = buckets;
+    map->seed = frozen_map_read32(blob + 16);
+    return UTILS_ERR_OK;
+}
+
+#ifdef ESP_PLATFORM
+int frozen_map_open_partition(frozen_map_t *map, const esp_partition_t *partition) {
+    const void *data;
+    frozen_map_mmap_handle_t handle;
+    int ret;
+    if (esp_partition_mmap(partition, 0, partition->size, FROZEN_MAP_MMAP_DATA, &data, &handle) != ESP_OK) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    if ((ret = frozen_map_open(map, data, (int)partition->size))) {
+        frozen_map_munmap(handle);
+        return ret;
+    }
+    map->mapped = true;
+    map->handle = handle;
+    return UTILS_ERR_OK;
+}
+
+void frozen_map_close(frozen_map_t *map) {
+    if (map->mapped) {
+        frozen_map_munmap(map->handle);
+    }
+    memset(map, 0, sizeof(frozen_map_t));
+}
+#else
+int frozen_map_open_file(frozen_map_t *map, const char *path) {
+    struct stat st;
+    void *data;
+    int ret;
+    int fd;
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        return UTILS_ERR_INVALID_DATA;
+    }
+    if (fstat(fd, &st) || st.st_size < FROZEN_MAP_HEADER_SIZE || st.st_size > INT32_MAX) {
+        close(fd);
+        return UTILS_ERR_INVALID_DATA;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    if ((ret = frozen_map_open(map, data, (int)st.st_size))) {
+        munmap(data, st.st_size);
+        return ret;
+    }
+    // The whole file is unmapped, the blob may be shorter
+    map->mapped = true;
+    map->handle = (uint32_t)st.st_size;
+    return UTILS_ERR_OK;
+}
+
+void frozen_map_close(frozen_map_t *map) {
+    if (map->mapped) {
+        munmap((void *)map->data, map->handle);
+    }
+    memset(map, 0, sizeof(frozen_map_t));
+}
+#endif
+
+int frozen_map_count(const frozen_map_t *map) {
+    return map->count;
+}
+
+// Return the entry of slot, or NULL if the blob is corrupted
+static const char *frozen_map_entry(const frozen_map_t *map, uint32_t slot, const unsigned char **value, int *len) {
+    const unsigned char *entry = map->data + FROZEN_MAP_HEADER_SIZE + map->buckets * 4 + slot * FROZEN_MAP_SLOT_SIZE;
+    uint32_t key_offset = frozen_map_read32(entry);
+    uint32_t value_offset = frozen_map_read32(entry + 4);
+    uint32_t value_length = frozen_map_read32(entry + 8);
+    if (key_offset >= (uint32_t)map->size || value_offset > (uint32_t)map->size ||
+        value_length > (uint32_t)map->size - value_offset) {
+        return NULL;
+    }
+    *value = map->data + value_offset;
+    *len = value_length;
+    return (const char *)map->data + key_offset;
+}
+
+const unsigned char *frozen_map_value_for_key(const frozen_map_t *map, const char *key, int *len) {
+    const unsigned char *value;
+    const char *entry_key;
+    if (!map->count) {
+        return NULL;
+    }
+    uint32_t hash = frozen_map_hash(key, map->seed);
+    int32_t displacement = (int32_t)frozen_map_read32(map->data + FROZEN_MAP_HEADER_SIZE + (hash % map->buckets) * 4);
+    uint32_t slot = displacement < 0 ? (uint32_t)(-1 - displacement) : frozen_map_slot(hash, displacement, map->count);
+    if (slot >= map->count || !(entry_key = frozen_map_entry(map, slot, &value, len)) || strcmp(entry_key, key)) {
+        return NULL;
+    }
+    return value;
+}
+
+const char *frozen_map_entry_at(const frozen_map_t *map, int index, const unsigned char **value, int *len) {
+    if (index < 0 || (uint32_t)index >= map->count) {
+        return NULL;
+    }
+    return frozen_map_entry(map, index, value, len);
+}
@@ -29,20 +29,173 @@
 #include "esp32-utils/mpi.h"
 #include "errno.h"
 
+// Bits per limb
+#define UTILS_MPI_LIMB_BITS         (sizeof(mbedtls_mpi_uint) * 8)
+
+// The pooled MPIs are allocated in one block, which tells them apart from any other MPI.
+// Free ones are kept on a stack
+struct _utils_mpi_pool {
+    mbedtls_mpi *mpis;
+    mbedtls_mpi **free_mpis;
+    int count;
+    int available;
+    size_t limbs;
+};
+
+static struct _utils_mpi_pool utils_mpi_pool;
+static portMUX_TYPE utils_mpi_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void utils_mpi_cleanup(void *mpi) {
+    mbedtls_mpi_free((mbedtls_mpi *)mpi);
+}
+
+#ifdef UTILS_STATS
+static int utils_mpi_pool_size(int count, size_t limbs) {
+    return count * (sizeof(mbedtls_mpi) + sizeof(mbedtls_mpi *) + limbs * sizeof(mbedtls_mpi_uint));
+}
+#endif
+
+static void utils_mpi_pool_release(mbedtls_mpi *mpis, mbedtls_mpi **free_mpis, int count) {
+    if (mpis) {
+        for (int i = 0; i < count; i++) {
+            mbedtls_mpi_free(&mpis[i]);
+        }
+    }
+    free(mpis);
+    free(free_mpis);
+}
+
+int utils_mpi_pool_init(int count, size_t bits) {
+    mbedtls_mpi *mpis = NULL;
+    mbedtls_mpi **free_mpis = NULL;
+    size_t limbs = (bits + UTILS_MPI_LIMB_BITS - 1) / UTILS_MPI_LIMB_BITS;
+    portENTER_CRITICAL(&utils_mpi_pool_lock);
+    bool in_use = utils_mpi_pool.mpis != NULL;
+    portEXIT_CRITICAL(&utils_mpi_pool_lock);
+    if (in_use) {
+        return UTILS_ERR_IN_USE;
+    }
+    if (!(mpis = (mbedtls_mpi *)calloc(count, sizeof(mbedtls_mpi)))) {
+        goto cleanup;
+    }
+    if (!(free_mpis = (mbedtls_mpi **)malloc(sizeof(mbedtls_mpi *) * count))) {
+        goto cleanup;
+    }
+    for (int i = 0; i < count; i++) {
+        mbedtls_mpi_init(&mpis[i]);
+        if (mbedtls_mpi_grow(&mpis[i], limbs)) {
+            goto cleanup;
+        }
+        free_mpis[i] = &mpis[i];
+    }
+    // The pool can't be allocated in the critical section, check again that no one else set it up
+    portENTER_CRITICAL(&utils_mpi_pool_lock);
+    if (utils_mpi_pool.mpis) {
+        portEXIT_CRITICAL(&utils_mpi_pool_lock);
+        utils_mpi_pool_release(mpis, free_mpis, count);
+        return UTILS_ERR_IN_USE;
+    }
+    utils_mpi_pool.mpis = mpis;
+    utils_mpi_pool.free_mpis = free_mpis;
+    utils_mpi_pool.count = count;
+    utils_mpi_pool.available = count;
+    utils_mpi_pool.limbs = limbs;
+    portEXIT_CRITICAL(&utils_mpi_pool_lock);
+    UTILS_STATS_RESIZE(UTILS_STATS_MPI, NULL, 0, utils_mpi_pool_size(count, limbs));
+    return UTILS_ERR_OK;
+cleanup:
+    utils_mpi_pool_release(mpis, free_mpis, count);
+    return UTILS_ERR_ALLOC_FAILED;
+}
+
+int utils_mpi_pool_deinit(void) {
+    portENTER_CRITICAL(&utils_mpi_pool_lock);
+    if (utils_mpi_pool.available != utils_mpi_pool.count) {
+        portEXIT_CRITICAL(&utils_mpi_pool_lock);
+        return UTILS_ERR_IN_USE;
+    }
+    struct _utils_mpi_pool pool = utils_mpi_pool;
+    memset(&utils_mpi_pool, 0, sizeof(struct _utils_mpi_pool));
+    portEXIT_CRITICAL(&utils_mpi_pool_lock);
+    utils_mpi_pool_release(pool.mpis, pool.free_mpis, pool.count);
+    UTILS_STATS_RESIZE(UTILS_STATS_MPI, NULL, utils_mpi_pool_size(pool.count, pool.limbs), 0);
+    return UTILS_ERR_OK;
+}
+
+int utils_mpi_pool_available(void) {
+    portENTER_CRITICAL(&utils_mpi_pool_lock);
+    int available = utils_mpi_pool.available;
+    portEXIT_CRITICAL(&utils_mpi_pool_lock);
+    return available;
+}
+
 mbedtls_mpi *utils_mpi_new(void) {
     mbedtls_mpi *mpi = NULL;
-    if (!(mpi = (mbedtls_mpi *)malloc(sizeof(mbedtls_mpi)))) {
-        return NULL;
+    portENTER_CRITICAL(&utils_mpi_pool_lock);
+    if (utils_mpi_pool.available) {
+        mpi = utils_mpi_pool.free_mpis[--utils_mpi_pool.available];
+    }
+    portEXIT_CRITICAL(&utils_mpi_pool_lock);
+    if (mpi) {
+        // The memory is accounted to the pool
+        UTILS_STATS_NEW(UTILS_STATS_MPI, NULL, 0);
+        return mpi;
+    }
+    // Pool empty or not set up
+    return utils_mpi_new_in(NULL);
+}
+
+mbedtls_mpi *utils_mpi_new_in(utils_arena_t arena) {
+    mbedtls_mpi *mpi = NULL;
+    if (!(mpi = (mbedtls_mpi *)utils_arena_malloc(arena, sizeof(mbedtls_mpi)))) {
+        goto cleanup;
     }
     mbedtls_mpi_init(mpi);
+    if (arena && utils_arena_add_cleanup(arena, utils_mpi_cleanup, mpi) != UTILS_ERR_OK) {
+        utils_arena_release(arena, mpi, sizeof(mbedtls_mpi));
+        goto cleanup;
+    }
+    UTILS_STATS_NEW(UTILS_STATS_MPI, arena, sizeof(mbedtls_mpi));
     return mpi;
+cleanup:
+    errno = UTILS_ERR_ALLOC_FAILED;
+    return NULL;
+}
+
+// Compared as integers, the MPI may come from anywhere
+static bool utils_mpi_is_pooled(mbedtls_mpi *mpi) {
+    uintptr_t address = (uintptr_t)mpi;
+    uintptr_t start = (uintptr_t)utils_mpi_pool.mpis;
+    return utils_mpi_pool.mpis && address >= start && address < start + sizeof(mbedtls_mpi) * utils_mpi_pool.count;
 }
 
 void utils_mpi_free(void *m) {
     mbedtls_mpi *mpi = (mbedtls_mpi *)m;
-    if (mpi) {
-   	  mbedtls_mpi_free(mpi);
-   	  free(mpi);
+    if (!mpi) {
+        return;
     }
+    portENTER_CRITICAL(&utils_mpi_pool_lock);
+    bool pooled = utils_mpi_is_pooled(mpi);
+    portEXIT_CRITICAL(&utils_mpi_pool_lock);
+    if (pooled) {
+        // Clear the value but keep the limbs, topping them up if they were freed. The pool
+        // can't go away while one of its MPIs is out
+        mbedtls_mpi_grow(mpi, utils_mpi_pool.limbs);
+        mbedtls_mpi_lset(mpi, 0);
+        portENTER_CRITICAL(&utils_mpi_pool_lock);
+        utils_mpi_pool.free_mpis[utils_mpi_pool.available++] = mpi;
+        portEXIT_CRITICAL(&utils_mpi_pool_lock);
+        UTILS_STATS_DELETE(UTILS_STATS_MPI, NULL, 0);
+        return;
+    }
+    mbedtls_mpi_free(mpi);
+    UTILS_STATS_DELETE(UTILS_STATS_MPI, NULL, sizeof(mbedtls_mpi));
+    free(mpi);
 }
 
+void utils_mpi_release(void *mpi) {
+    // The MPI stays allocated until the arena is reset, its cleanup still refers to it
+    if (mpi) {
+        mbedtls_mpi_free((mbedtls_mpi *)mpi);
+    }
+}
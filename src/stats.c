@@ -0,0 +1,133 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include "esp32-utils/stats.h"
+#include <stdatomic.h>
+
+static const char *utils_stats_kind_names[UTILS_STATS_KINDS] = { "array", "map", "buffer", "mpi" };
+
+const char *utils_stats_kind_name(utils_stats_kind_t kind) {
+    return (kind >= 0 && kind < UTILS_STATS_KINDS) ? utils_stats_kind_names[kind] : "unknown";
+}
+
+#ifdef UTILS_STATS
+// Counters are updated from any task, without locking
+typedef struct {
+    atomic_int objects;
+    atomic_int bytes;
+    atomic_int peak_bytes;
+    atomic_int allocs;
+    atomic_int reallocs;
+} utils_stats_atomic_counters_t;
+
+static utils_stats_atomic_counters_t utils_stats_kinds[UTILS_STATS_KINDS];
+static atomic_int utils_stats_map_probes[UTILS_STATS_PROBE_BUCKETS];
+
+static void utils_stats_add_bytes(utils_stats_atomic_counters_t *counters, int size) {
+    int bytes = atomic_fetch_add_explicit(&counters->bytes, size, memory_order_relaxed) + size;
+    int peak = atomic_load_explicit(&counters->peak_bytes, memory_order_relaxed);
+    while (bytes > peak &&
+           !atomic_compare_exchange_weak_explicit(&counters->peak_bytes, &peak, bytes, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void utils_stats_new(utils_stats_kind_t kind, utils_arena_t arena, int size) {
+    if (arena) {
+        return;
+    }
+    utils_stats_atomic_counters_t *counters = &utils_stats_kinds[kind];
+    atomic_fetch_add_explicit(&counters->objects, 1, memory_order_relaxed);
+    if (size) {
+        atomic_fetch_add_explicit(&counters->allocs, 1, memory_order_relaxed);
+        utils_stats_add_bytes(counters, size);
+    }
+}
+
+void utils_stats_delete(utils_stats_kind_t kind, utils_arena_t arena, int size) {
+    if (arena) {
+        return;
+    }
+    utils_stats_atomic_counters_t *counters = &utils_stats_kinds[kind];
+    atomic_fetch_sub_explicit(&counters->objects, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&counters->bytes, size, memory_order_relaxed);
+}
+
+void utils_stats_resize(utils_stats_kind_t kind, utils_arena_t arena, int old_size, int new_size) {
+    if (arena || old_size == new_size) {
+        return;
+    }
+    utils_stats_atomic_counters_t *counters = &utils_stats_kinds[kind];
+    if (new_size && old_size) {
+        atomic_fetch_add_explicit(&counters->reallocs, 1, memory_order_relaxed);
+    }
+    else if (new_size) {
+        atomic_fetch_add_explicit(&counters->allocs, 1, memory_order_relaxed);
+    }
+    utils_stats_add_bytes(counters, new_size - old_size);
+}
+
+void utils_stats_probe(int length) {
+    int bucket = (length < UTILS_STATS_PROBE_BUCKETS) ? length : UTILS_STATS_PROBE_BUCKETS - 1;
+    atomic_fetch_add_explicit(&utils_stats_map_probes[bucket], 1, memory_order_relaxed);
+}
+
+int utils_stats_snapshot(utils_stats_t *stats) {
+    for (int i = 0; i < UTILS_STATS_KINDS; i++) {
+        stats->kinds[i].objects = atomic_load_explicit(&utils_stats_kinds[i].objects, memory_order_relaxed);
+        stats->kinds[i].bytes = atomic_load_explicit(&utils_stats_kinds[i].bytes, memory_order_relaxed);
+        stats->kinds[i].peak_bytes = atomic_load_explicit(&utils_stats_kinds[i].peak_bytes, memory_order_relaxed);
+        stats->kinds[i].allocs = atomic_load_explicit(&utils_stats_kinds[i].allocs, memory_order_relaxed);
+        stats->kinds[i].reallocs = atomic_load_explicit(&utils_stats_kinds[i].reallocs, memory_order_relaxed);
+    }
+    for (int i = 0; i < UTILS_STATS_PROBE_BUCKETS; i++) {
+        stats->map_probes[i] = atomic_load_explicit(&utils_stats_map_probes[i], memory_order_relaxed);
+    }
+    return UTILS_ERR_OK;
+}
+
+void utils_stats_reset(void) {
+    for (int i = 0; i < UTILS_STATS_KINDS; i++) {
+        int bytes = atomic_load_explicit(&utils_stats_kinds[i].bytes, memory_order_relaxed);
+        atomic_store_explicit(&utils_stats_kinds[i].peak_bytes, bytes, memory_order_relaxed);
+        atomic_store_explicit(&utils_stats_kinds[i].allocs, 0, memory_order_relaxed);
+        atomic_store_explicit(&utils_stats_kinds[i].reallocs, 0, memory_order_relaxed);
+    }
+    for (int i = 0; i < UTILS_STATS_PROBE_BUCKETS; i++) {
+        atomic_store_explicit(&utils_stats_map_probes[i], 0, memory_order_relaxed);
+    }
+}
+#else
+int utils_stats_snapshot(utils_stats_t *stats) {
+    memset(stats, 0, sizeof(utils_stats_t));
+    return UTILS_ERR_NOT_SUPPORTED;
+}
+
+void utils_stats_reset(void) {
+}
+#endif
@@ -0,0 +1,285 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include "esp32-utils/vector.h"
+#include <stdint.h>
+
+/***********************************************************************************************************
+ * Vector
+ ***********************************************************************************************************/
+// Same growth policy as arrays
+#define VECTOR_MIN_CAPACITY         4
+#define VECTOR_SORT_THRESHOLD       16
+
+// Aligned storage is over-allocated by alignment bytes, the pointer actually allocated is kept just
+// before the first element
+static size_t vector_storage_size(utils_vector_t *vector, size_t element_size, int capacity) {
+    if (!capacity) {
+        return 0;
+    }
+    return element_size * capacity + vector->alignment;
+}
+
+static void vector_release_storage(utils_vector_t *vector, size_t element_size) {
+    if (vector->elements) {
+        void *storage = vector->alignment ? ((void **)vector->elements)[-1] : vector->elements;
+        utils_arena_release(vector->arena, storage, vector_storage_size(vector, element_size, vector->capacity));
+    }
+}
+
+void *utils_vector_new(utils_arena_t arena, size_t header_size, int alignment) {
+    utils_vector_t *vector;
+    if (!(vector = (utils_vector_t *)utils_arena_malloc(arena, header_size))) {
+        goto cleanup;
+    }
+    memset(vector, 0, header_size);
+    vector->arena = arena;
+    // The offset to the aligned address must leave room for the allocated pointer
+    if (alignment && alignment < (int)sizeof(void *)) {
+        alignment = sizeof(void *);
+    }
+    vector->alignment = alignment;
+    UTILS_STATS_NEW(UTILS_STATS_ARRAY, arena, header_size);
+    return vector;
+cleanup:
+    errno = UTILS_ERR_ALLOC_FAILED;
+    return NULL;
+}
+
+void utils_vector_free(utils_vector_t *vector, size_t header_size, size_t element_size) {
+    UTILS_STATS_DELETE(UTILS_STATS_ARRAY, vector->arena, header_size + vector_storage_size(vector, element_size, vector->capacity));
+    vector_release_storage(vector, element_size);
+    utils_arena_release(vector->arena, vector, header_size);
+}
+
+int utils_vector_set_capacity(utils_vector_t *vector, size_t element_size, int capacity) {
+    if (capacity < vector->count) {
+        capacity = vector->count;
+    }
+    if (capacity == vector->capacity) {
+        return UTILS_ERR_OK;
+    }
+    if ((size_t)capacity > (SIZE_MAX - vector->alignment) / element_size) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    size_t old_size = vector_storage_size(vector, element_size, vector->capacity);
+    size_t size = vector_storage_size(vector, element_size, capacity);
+    unsigned char *elements = NULL;
+    if (!capacity) {
+        vector_release_storage(vector, element_size);
+    }
+    else if (!vector->alignment) {
+        if (!(elements = (unsigned char *)utils_arena_realloc(vector->arena, vector->elements, old_size, size))) {
+            return UTILS_ERR_ALLOC_FAILED;
+        }
+    }
+    else {
+        // Moving the block could change its alignment, so aligned storage is always copied
+        unsigned char *storage;
+        if (!(storage = (unsigned char *)utils_arena_malloc(vector->arena, size))) {
+            return UTILS_ERR_ALLOC_FAILED;
+        }
+        uintptr_t address = (uintptr_t)storage + sizeof(void *);
+        elements = (unsigned char *)((address + vector->alignment - 1) & ~(uintptr_t)(vector->alignment - 1));
+        ((void **)elements)[-1] = storage;
+        if (vector->count) {
+            memcpy(elements, vector->elements, element_size * vector->count);
+        }
+        vector_release_storage(vector, element_size);
+    }
+    UTILS_STATS_RESIZE(UTILS_STATS_ARRAY, vector->arena, old_size, size);
+    vector->elements = elements;
+    vector->capacity = capacity;
+    return UTILS_ERR_OK;
+}
+
+// Make room for count elements, growing geometrically
+int utils_vector_ensure_capacity(utils_vector_t *vector, size_t element_size, int count) {
+    if (count <= vector->capacity) {
+        return UTILS_ERR_OK;
+    }
+    int capacity = vector->capacity + vector->capacity / 2;
+    if (capacity < VECTOR_MIN_CAPACITY) {
+        capacity = VECTOR_MIN_CAPACITY;
+    }
+    if (capacity < count) {
+        capacity = count;
+    }
+    return utils_vector_set_capacity(vector, element_size, capacity);
+}
+
+int utils_vector_insert(utils_vector_t *vector, size_t element_size, int index, int count) {
+    if (index < 0 || index > vector->count || count < 0) {
+        return UTILS_ERR_OUT_OF_RANGE;
+    }
+    // An empty vector may have no storage yet
+    if (!count) {
+        return UTILS_ERR_OK;
+    }
+    if (utils_vector_ensure_capacity(vector, element_size, vector->count + count) != UTILS_ERR_OK) {
+        return UTILS_ERR_ALLOC_FAILED;
+    }
+    memmove(vector->elements + element_size * (index + count), vector->elements + element_size * index,
+        element_size * (vector->count - index));
+    vector->count += count;
+    return UTILS_ERR_OK;
+}
+
+int utils_vector_erase(utils_vector_t *vector, size_t element_size, int index, int count) {
+    if (index < 0 || count < 0 || count > vector->count - index) {
+        return UTILS_ERR_OUT_OF_RANGE;
+    }
+    if (!count) {
+        return UTILS_ERR_OK;
+    }
+    memmove(vector->elements + element_size * index, vector->elements + element_size * (index + count),
+        element_size * (vector->count - index - count));
+    vector->count -= count;
+    return UTILS_ERR_OK;
+}
+
+// Elements have any size, so the sort only ever swaps them. Storage is word aligned, so are
+// elements whose size is a multiple of a word
+static void vector_swap(unsigned char *a, unsigned char *b, size_t element_size) {
+    if (!(element_size % sizeof(uint32_t))) {
+        for (uint32_t *x = (uint32_t *)a, *y = (uint32_t *)b, *end = (uint32_t *)(a + element_size); x < end; x++, y++) {
+            uint32_t word = *x;
+            *x = *y;
+            *y = word;
+        }
+        return;
+    }
+    for (unsigned char *end = a + element_size; a < end; a++, b++) {
+        unsigned char byte = *a;
+        *a = *b;
+        *b = byte;
+    }
+}
+
+static void vector_insertion_sort(unsigned char *elements, int count, size_t element_size, element_compare *compare) {
+    for (int i = 1; i < count; i++) {
+        for (unsigned char *element = elements + element_size * i;
+            element > elements && compare(element - element_size, element) > 0; element -= element_size) {
+            vector_swap(element - element_size, element, element_size);
+        }
+    }
+}
+
+static void vector_sift_down(unsigned char *elements, int root, int count, size_t element_size, element_compare *compare) {
+    for (int child; (child = root * 2 + 1) < count; root = child) {
+        if (child + 1 < count && compare(elements + element_size * child, elements + element_size * (child + 1)) < 0) {
+            child++;
+        }
+        if (compare(elements + element_size * root, elements + element_size * child) >= 0) {
+            return;
+        }
+        vector_swap(elements + element_size * root, elements + element_size * child, element_size);
+    }
+}
+
+static void vector_heap_sort(unsigned char *elements, int count, size_t element_size, element_compare *compare) {
+    for (int i = count / 2 - 1; i >= 0; i--) {
+        vector_sift_down(elements, i, count, element_size, compare);
+    }
+    for (int i = count - 1; i > 0; i--) {
+        vector_swap(elements, elements + element_size * i, element_size);
+        vector_sift_down(elements, 0, i, element_size, compare);
+    }
+}
+
+// Same introsort as arrays, the pivot stays at the front while partitioning
+static void vector_intro_sort(unsigned char *elements, int count, int depth, size_t element_size, element_compare *compare) {
+    while (count > VECTOR_SORT_THRESHOLD) {
+        if (!depth--) {
+            vector_heap_sort(elements, count, element_size, compare);
+            return;
+        }
+        unsigned char *first = elements;
+        unsigned char *mid = elements + element_size * (count / 2);
+        unsigned char *last = elements + element_size * (count - 1);
+        if (compare(mid, first) < 0) {
+            vector_swap(mid, first, element_size);
+        }
+        if (compare(last, mid) < 0) {
+            vector_swap(last, mid, element_size);
+            if (compare(mid, first) < 0) {
+                vector_swap(mid, first, element_size);
+            }
+        }
+        vector_swap(first, mid, element_size);
+        int i = 0;
+        int j = count;
+        for (;;) {
+            while (compare(elements + element_size * ++i, first) < 0 && i < count - 1) {
+            }
+            while (compare(first, elements + element_size * --j) < 0) {
+            }
+            if (i >= j) {
+                break;
+            }
+            vector_swap(elements + element_size * i, elements + element_size * j, element_size);
+        }
+        vector_swap(first, elements + element_size * j, element_size);
+        if (j < count - j - 1) {
+            vector_intro_sort(elements, j, depth, element_size, compare);
+            elements += element_size * (j + 1);
+            count -= j + 1;
+        }
+        else {
+            vector_intro_sort(elements + element_size * (j + 1), count - j - 1, depth, element_size, compare);
+            count = j;
+        }
+    }
+    vector_insertion_sort(elements, count, element_size, compare);
+}
+
+void utils_vector_sort(utils_vector_t *vector, size_t element_size, element_compare *compare) {
+    int depth = 0;
+    for (int count = vector->count; count > 1; count >>= 1) {
+        depth += 2;
+    }
+    vector_intro_sort(vector->elements, vector->count, depth, element_size, compare);
+}
+
+// With upper set, the first element greater than element, so that equal elements stay in insertion order
+int utils_vector_lower_bound(utils_vector_t *vector, size_t element_size, const void *element, element_compare *compare, bool upper) {
+    int low = 0;
+    int high = vector->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        int order = compare(vector->elements + element_size * mid, element);
+        if (order < 0 || (upper && !order)) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
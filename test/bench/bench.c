@@ -0,0 +1,180 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "bench.h"
+
+volatile uintptr_t bench_sink;
+
+static const bench_case_t bench_cases[] = {
+    { "array/push_pop",             bench_array_push_pop,               1000000, 0 },
+    { "array/exact_fit_push_pop",   bench_array_exact_fit_push_pop,     100000,  0 },
+    { "array/reserved_push_pop",    bench_array_reserved_push_pop,      1000000, 0 },
+    { "array/remove_front",         bench_array_remove_front,           20000,   0 },
+    { "array/sort/1000",            bench_array_sort,                   2000,    1000 },
+    { "array/qsort/1000",           bench_array_qsort,                  2000,    1000 },
+    { "array/linear_search/256",    bench_array_linear_search,          100000,  256 },
+    { "array/bsearch/256",          bench_array_bsearch,                100000,  256 },
+    { "array/remove_each/1000",     bench_array_remove_each,            2000,    1000 },
+    { "array/remove_if/1000",       bench_array_remove_if,              2000,    1000 },
+    { "array/remove_head/1000",     bench_array_remove_head,            2000,    1000 },
+    { "array/remove_range/1000",    bench_array_remove_range,           2000,    1000 },
+    { "vector/boxed/1000",          bench_vector_boxed,                 2000,    1000 },
+    { "vector/inline/1000",         bench_vector_inline,                2000,    1000 },
+    { "deque/remove_front",         bench_deque_remove_front,           20000,   0 },
+    { "deque/queue_array/1000",     bench_deque_queue_array,            200000,  1000 },
+    { "deque/queue_deque/1000",     bench_deque_queue_deque,            200000,  1000 },
+    { "pqueue/scan_array/1000",     bench_pqueue_scan_array,            20000,   1000 },
+    { "pqueue/heap/1000",           bench_pqueue_heap,                  200000,  1000 },
+    { "pqueue/update/1000",         bench_pqueue_update,                200000,  1000 },
+    { "map/set/16",                 bench_map_set,                      200000,  16 },
+    { "map/set/256",                bench_map_set,                      200000,  256 },
+    { "map/set/4096",               bench_map_set,                      200000,  4096 },
+    { "map/get/16",                 bench_map_get,                      1000000, 16 },
+    { "map/get/256",                bench_map_get,                      1000000, 256 },
+    { "map/get/4096",               bench_map_get,                      1000000, 4096 },
+    { "map/get_missing/4096",       bench_map_get_missing,              1000000, 4096 },
+    { "map/remove/4096",            bench_map_remove,                   200000,  4096 },
+    { "map/common_keys/strdup",     bench_map_common_keys_strdup,       10000,   64 },
+    { "map/common_keys/pool",       bench_map_common_keys_pool,         10000,   64 },
+    { "map/shared_mutex/1",         bench_map_shared_mutex,             2000000, 1 },
+    { "map/shared_concurrent/1",    bench_map_shared_concurrent,        2000000, 1 },
+    { "map/shared_mutex/2",         bench_map_shared_mutex,             2000000, 2 },
+    { "map/shared_concurrent/2",    bench_map_shared_concurrent,        2000000, 2 },
+    { "map/shared_mutex/4",         bench_map_shared_mutex,             2000000, 4 },
+    { "map/shared_concurrent/4",    bench_map_shared_concurrent,        2000000, 4 },
+    { "map/concurrent_write/2",     bench_map_concurrent_write,         20000,   2 },
+    { "buffer/append/1",            bench_buffer_append,                1000000, 1 },
+    { "buffer/append/16",           bench_buffer_append,                1000000, 16 },
+    { "buffer/append/256",          bench_buffer_append,                200000,  256 },
+    { "buffer/resize",              bench_buffer_resize,                200000,  0 },
+    { "buffer/new_free/16",         bench_buffer_new_free,              1000000, 16 },
+    { "buffer/clone/64",            bench_buffer_clone,                 1000000, 64 },
+    { "buffer/copy_field/64",       bench_buffer_copy_field,            1000000, 64 },
+    { "buffer/slice_field/64",      bench_buffer_slice_field,           1000000, 64 },
+    { "buffer/assemble/16",         bench_buffer_assemble,              100000,  16 },
+    { "buffer/assemble/64",         bench_buffer_assemble,              20000,   64 },
+    { "buffer/chain_assemble/16",   bench_buffer_chain_assemble,        100000,  16 },
+    { "buffer/chain_assemble/64",   bench_buffer_chain_assemble,        20000,   64 },
+    { "buffer/hex_sprintf/4096",    bench_buffer_hex_sprintf,           2000,    4096 },
+    { "buffer/hex_encode/4096",     bench_buffer_hex_encode,            20000,   4096 },
+    { "buffer/hex_decode/4096",     bench_buffer_hex_decode,            20000,   4096 },
+    { "buffer/base64_encode/4096",  bench_buffer_base64_encode,         20000,   4096 },
+    { "buffer/base64_decode/4096",  bench_buffer_base64_decode,         20000,   4096 },
+    { "buffer/parse_copy/64",       bench_buffer_parse_copy,            20000,   64 },
+    { "buffer/parse_reader/64",     bench_buffer_parse_reader,          20000,   64 },
+    { "ring/stream/64",             bench_ring_stream,                  200000,  64 },
+    { "ring/stream/1024",           bench_ring_stream,                  20000,   1024 },
+    { "ring/pingpong/16",           bench_ring_pingpong,                20000,   16 },
+    { "mpi/new_free/heap/256",      bench_mpi_new_free_heap,            100000,  256 },
+    { "mpi/new_free/pool/256",      bench_mpi_new_free_pool,            100000,  256 },
+    { "mpi/buffer_new/256",         bench_mpi_buffer_new,               100000,  256 },
+    { "mpi/append_each/256",        bench_mpi_append_each,              100000,  256 },
+    { "mpi/append_batch/256",       bench_mpi_append_batch,             100000,  256 },
+    { "dump/data/4096",             bench_dump_data,                    200,     4096 },
+    { "dump/data_sink/4096",        bench_dump_data_sink,               200,     4096 },
+    { "dump/data/64",               bench_dump_data,                    200000,  64 },
+    { "dump/data_sink/64",          bench_dump_data_sink,               200000,  64 },
+    { "dump/async/64",              bench_dump_async,                   4000,    64 },
+    { "arena/request/heap",         bench_arena_request_heap,           100000,  0 },
+    { "arena/request/arena",        bench_arena_request_arena,          100000,  0 },
+    { "cbor/encode/32",             bench_cbor_encode,                  20000,   32 },
+    { "cbor/json_encode/32",        bench_cbor_json_encode_state,       20000,   32 },
+    { "cbor/decode/32",             bench_cbor_decode,                  20000,   32 },
+    { "cbor/json_decode/32",        bench_cbor_json_decode_state,       20000,   32 },
+    { "cbor/visit/32",              bench_cbor_visit,                   20000,   32 },
+    { "cbor/round_trip",            bench_cbor_round_trip,              5000,    0 },
+    { "frozen/startup_map/1000",    bench_frozen_startup_map,           200,     1000 },
+    { "frozen/startup_blob/1000",   bench_frozen_startup_blob,          2000,    1000 },
+    { "frozen/lookup_map/1000",     bench_frozen_lookup_map,            1000000, 1000 },
+    { "frozen/lookup_blob/1000",    bench_frozen_lookup_blob,           1000000, 1000 },
+};
+
+void bench_reset_timer(bench_t *b) {
+    b->elapsed_ns = 0;
+    b->allocs = 0;
+    b->bytes = 0;
+    if (b->running) {
+        b->running = false;
+        bench_start_timer(b);
+    }
+}
+
+void bench_stop_timer(bench_t *b) {
+    if (b->running) {
+        long allocs = 0, bytes = 0;
+        b->elapsed_ns += bench_now_ns() - b->start_ns;
+        bench_alloc_counters(&allocs, &bytes);
+        b->allocs += allocs - b->start_allocs;
+        b->bytes += bytes - b->start_bytes;
+        b->running = false;
+    }
+}
+
+void bench_start_timer(bench_t *b) {
+    if (!b->running) {
+        bench_alloc_counters(&b->start_allocs, &b->start_bytes);
+        b->running = true;
+        b->start_ns = bench_now_ns();
+    }
+}
+
+int bench_run(FILE *out, const char *filter, int scale_down) {
+    int failed = 0;
+    long allocs, bytes;
+    bool count_allocs = bench_alloc_counters(&allocs, &bytes);
+    fprintf(out, "%-28s %10s %12s %12s %12s\n", "benchmark", "ops", "ns/op", "allocs/op", "bytes/op");
+    for (int i = 0; i < sizeof(bench_cases) / sizeof(bench_case_t); i++) {
+        const bench_case_t *bench_case = &bench_cases[i];
+        if (filter && !strstr(bench_case->name, filter)) {
+            continue;
+        }
+        bench_t b;
+        memset(&b, 0, sizeof(bench_t));
+        b.n = bench_case->n / scale_down;
+        if (b.n < 1) {
+            b.n = 1;
+        }
+        b.arg = bench_case->arg;
+        bench_start_timer(&b);
+        int ret = bench_case->func(&b);
+        bench_stop_timer(&b);
+        if (ret) {
+            fprintf(out, "%-28s FAILED\n", bench_case->name);
+            failed++;
+            continue;
+        }
+        fprintf(out, "%-28s %10d %12.1f", bench_case->name, b.n, (double)b.elapsed_ns / b.n);
+        if (count_allocs) {
+            fprintf(out, " %12.3f %12.1f\n", (double)b.allocs / b.n, (double)b.bytes / b.n);
+        }
+        else {
+            fprintf(out, " %12s %12s\n", "-", "-");
+        }
+    }
+    return failed;
+}
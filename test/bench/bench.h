@@ -0,0 +1,153 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef _UTILS_BENCH_H_
+#define _UTILS_BENCH_H_
+
+#include "esp32-utils/utils.h"
+
+typedef struct {
+    // Number of operations to run
+    int n;
+    // Benchmark specific parameter, such as a collection size
+    int arg;
+    bool running;
+    int64_t start_ns;
+    int64_t elapsed_ns;
+    long start_allocs;
+    long start_bytes;
+    long allocs;
+    long bytes;
+} bench_t;
+
+// Return 0, or -1 if a sanity check failed
+typedef int(bench_func)(bench_t *b);
+
+typedef struct {
+    const char *name;
+    bench_func *func;
+    int n;
+    int arg;
+} bench_case_t;
+
+// Provided by the platform running the benchmarks
+int64_t bench_now_ns(void);
+// Return false if allocations can't be counted on this platform
+bool bench_alloc_counters(long *count, long *bytes);
+
+// Discard what was measured so far, to exclude setup
+void bench_reset_timer(bench_t *b);
+// Pause and resume the measurement, to exclude teardown or per-round setup
+void bench_stop_timer(bench_t *b);
+void bench_start_timer(bench_t *b);
+// Run the benchmarks whose name contains filter, or all of them if NULL.
+// Operation counts are divided by scale_down. Return the number of failed benchmarks.
+int bench_run(FILE *out, const char *filter, int scale_down);
+
+// Keeps results alive so that the compiler doesn't optimize the work away
+extern volatile uintptr_t bench_sink;
+
+int bench_array_push_pop(bench_t *b);
+int bench_array_exact_fit_push_pop(bench_t *b);
+int bench_array_reserved_push_pop(bench_t *b);
+int bench_array_remove_front(bench_t *b);
+int bench_array_sort(bench_t *b);
+int bench_array_qsort(bench_t *b);
+int bench_array_linear_search(bench_t *b);
+int bench_array_bsearch(bench_t *b);
+int bench_array_remove_each(bench_t *b);
+int bench_array_remove_if(bench_t *b);
+int bench_array_remove_head(bench_t *b);
+int bench_array_remove_range(bench_t *b);
+
+int bench_vector_boxed(bench_t *b);
+int bench_vector_inline(bench_t *b);
+
+int bench_deque_remove_front(bench_t *b);
+int bench_deque_queue_array(bench_t *b);
+int bench_deque_queue_deque(bench_t *b);
+
+int bench_pqueue_scan_array(bench_t *b);
+int bench_pqueue_heap(bench_t *b);
+int bench_pqueue_update(bench_t *b);
+
+int bench_map_set(bench_t *b);
+int bench_map_get(bench_t *b);
+int bench_map_get_missing(bench_t *b);
+int bench_map_remove(bench_t *b);
+int bench_map_common_keys_strdup(bench_t *b);
+int bench_map_common_keys_pool(bench_t *b);
+int bench_map_shared_mutex(bench_t *b);
+int bench_map_shared_concurrent(bench_t *b);
+int bench_map_concurrent_write(bench_t *b);
+
+int bench_buffer_append(bench_t *b);
+int bench_buffer_resize(bench_t *b);
+int bench_buffer_new_free(bench_t *b);
+int bench_buffer_clone(bench_t *b);
+int bench_buffer_copy_field(bench_t *b);
+int bench_buffer_slice_field(bench_t *b);
+int bench_buffer_assemble(bench_t *b);
+int bench_buffer_chain_assemble(bench_t *b);
+int bench_buffer_hex_sprintf(bench_t *b);
+int bench_buffer_hex_encode(bench_t *b);
+int bench_buffer_hex_decode(bench_t *b);
+int bench_buffer_base64_encode(bench_t *b);
+int bench_buffer_base64_decode(bench_t *b);
+int bench_buffer_parse_copy(bench_t *b);
+int bench_buffer_parse_reader(bench_t *b);
+
+int bench_ring_stream(bench_t *b);
+int bench_ring_pingpong(bench_t *b);
+
+int bench_mpi_new_free_heap(bench_t *b);
+int bench_mpi_new_free_pool(bench_t *b);
+int bench_mpi_buffer_new(bench_t *b);
+int bench_mpi_append_each(bench_t *b);
+int bench_mpi_append_batch(bench_t *b);
+
+int bench_dump_data(bench_t *b);
+int bench_dump_data_sink(bench_t *b);
+int bench_dump_async(bench_t *b);
+
+int bench_arena_request_heap(bench_t *b);
+int bench_arena_request_arena(bench_t *b);
+
+int bench_cbor_encode(bench_t *b);
+int bench_cbor_json_encode_state(bench_t *b);
+int bench_cbor_decode(bench_t *b);
+int bench_cbor_json_decode_state(bench_t *b);
+int bench_cbor_visit(bench_t *b);
+int bench_cbor_round_trip(bench_t *b);
+
+int bench_frozen_startup_map(bench_t *b);
+int bench_frozen_startup_blob(bench_t *b);
+int bench_frozen_lookup_map(bench_t *b);
+int bench_frozen_lookup_blob(bench_t *b);
+
+#endif
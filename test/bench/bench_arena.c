@@ -0,0 +1,85 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include "bench.h"
+
+static const char *bench_arena_keys[] = { "id", "type", "session", "nonce", "status", "payload", "signature", "salt" };
+
+// What a typical request handler creates, from arena or from the heap if it is NULL
+static int bench_arena_request(utils_arena_t arena) {
+    array_t buffers = array_new_in(arena, buffer_free);
+    map_t fields = map_new_in(arena, buffer_free);
+    array_t numbers = array_new_in(arena, arena ? utils_mpi_release : utils_mpi_free);
+    if (!buffers || !fields || !numbers) {
+        return -1;
+    }
+    for (int i = 0; i < 8; i++) {
+        buffer_t buffer = buffer_new_in(arena, 16);
+        buffer_append_string(buffer, "0123456789abcdef");
+        array_push(buffers, buffer);
+        buffer_t field = buffer_new_in(arena, 32);
+        buffer_append_string(field, bench_arena_keys[i]);
+        map_set_value_for_key(fields, bench_arena_keys[i], field);
+    }
+    for (int i = 0; i < 4; i++) {
+        mbedtls_mpi *mpi = utils_mpi_new_in(arena);
+        mbedtls_mpi_lset(mpi, i);
+        array_push(numbers, mpi);
+    }
+    bench_sink = map_count(fields) + array_count(buffers) + array_count(numbers);
+    if (!arena) {
+        array_free(buffers);
+        map_free(fields);
+        array_free(numbers);
+    }
+    return 0;
+}
+
+int bench_arena_request_heap(bench_t *b) {
+    for (int i = 0; i < b->n; i++) {
+        if (bench_arena_request(NULL)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int bench_arena_request_arena(bench_t *b) {
+    utils_arena_t arena = utils_arena_new(4096);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        if (bench_arena_request(arena)) {
+            return -1;
+        }
+        utils_arena_reset(arena);
+    }
+    bench_stop_timer(b);
+    utils_arena_free(arena);
+    return 0;
+}
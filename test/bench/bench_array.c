@@ -0,0 +1,270 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "bench.h"
+
+int bench_array_push_pop(bench_t *b) {
+    array_t array = array_new(NULL);
+    for (int i = 0; i < b->n / 2; i++) {
+        array_push(array, (void *)(uintptr_t)i);
+    }
+    while (array_count(array)) {
+        bench_sink = (uintptr_t)array_pop(array);
+    }
+    array_free(array);
+    return 0;
+}
+
+// The way array_t used to grow: one realloc per push and per pop
+int bench_array_exact_fit_push_pop(bench_t *b) {
+    void **elements = NULL;
+    for (int i = 0; i < b->n / 2; i++) {
+        elements = (void **)realloc(elements, sizeof(void *) * (i + 1));
+        elements[i] = (void *)(uintptr_t)i;
+    }
+    for (int i = b->n / 2 - 1; i >= 0; i--) {
+        bench_sink = (uintptr_t)elements[i];
+        elements = (void **)realloc(elements, sizeof(void *) * i);
+    }
+    free(elements);
+    return 0;
+}
+
+int bench_array_reserved_push_pop(bench_t *b) {
+    array_t array = array_new(NULL);
+    array_reserve(array, b->n / 2);
+    for (int i = 0; i < b->n / 2; i++) {
+        array_push(array, (void *)(uintptr_t)i);
+    }
+    while (array_count(array)) {
+        bench_sink = (uintptr_t)array_pop(array);
+    }
+    array_free(array);
+    return 0;
+}
+
+// Array used as a FIFO
+int bench_array_remove_front(bench_t *b) {
+    array_t array = array_new(NULL);
+    for (int i = 0; i < b->n; i++) {
+        array_push(array, (void *)(uintptr_t)i);
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        if ((uintptr_t)array_remove_at(array, 0) != i) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    array_free(array);
+    return 0;
+}
+
+static int bench_array_compare(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)a;
+    uintptr_t y = (uintptr_t)b;
+    return (x > y) - (x < y);
+}
+
+static int bench_array_qsort_compare(const void *a, const void *b) {
+    return bench_array_compare(*(void * const *)a, *(void * const *)b);
+}
+
+static void bench_array_shuffled(array_t array, int count) {
+    uint32_t seed = 12345;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        array_push(array, (void *)(uintptr_t)(seed >> 8));
+    }
+}
+
+// Sort b->arg shuffled elements per operation
+int bench_array_sort(bench_t *b) {
+    array_t array = array_new(NULL);
+    array_t shuffled = array_new(NULL);
+    bench_array_shuffled(shuffled, b->arg);
+    array_reserve(array, b->arg);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        bench_stop_timer(b);
+        while (array_count(array)) {
+            array_pop(array);
+        }
+        for (int j = 0; j < b->arg; j++) {
+            array_push(array, array_at(shuffled, j));
+        }
+        bench_start_timer(b);
+        array_sort(array, bench_array_compare);
+    }
+    bench_stop_timer(b);
+    int ret = 0;
+    for (int j = 1; j < b->arg; j++) {
+        if ((uintptr_t)array_at(array, j - 1) > (uintptr_t)array_at(array, j)) {
+            ret = -1;
+        }
+    }
+    array_free(array);
+    array_free(shuffled);
+    return ret;
+}
+
+// Same as above with the C library qsort, for comparison
+int bench_array_qsort(bench_t *b) {
+    array_t shuffled = array_new(NULL);
+    bench_array_shuffled(shuffled, b->arg);
+    void **elements = (void **)malloc(sizeof(void *) * b->arg);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        bench_stop_timer(b);
+        for (int j = 0; j < b->arg; j++) {
+            elements[j] = array_at(shuffled, j);
+        }
+        bench_start_timer(b);
+        qsort(elements, b->arg, sizeof(void *), bench_array_qsort_compare);
+    }
+    bench_stop_timer(b);
+    bench_sink = (uintptr_t)elements[0];
+    free(elements);
+    array_free(shuffled);
+    return 0;
+}
+
+// Look up elements of a sorted table of b->arg elements, by scanning or by binary search
+static int bench_array_lookup(bench_t *b, bool binary) {
+    array_t array = array_new(NULL);
+    for (int i = 0; i < b->arg; i++) {
+        array_push(array, (void *)(uintptr_t)(i * 2));
+    }
+    int found = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        void *element = (void *)(uintptr_t)((i % b->arg) * 2);
+        if (binary) {
+            found += (array_bsearch(array, element, bench_array_compare) >= 0);
+        }
+        else {
+            for (int j = 0; j < array_count(array); j++) {
+                if (array_at(array, j) == element) {
+                    found++;
+                    break;
+                }
+            }
+        }
+    }
+    bench_stop_timer(b);
+    array_free(array);
+    return (found == b->n) ? 0 : -1;
+}
+
+int bench_array_linear_search(bench_t *b) {
+    return bench_array_lookup(b, false);
+}
+
+int bench_array_bsearch(bench_t *b) {
+    return bench_array_lookup(b, true);
+}
+
+static bool bench_array_is_odd(void *element, void *context) {
+    return (uintptr_t)element & 1;
+}
+
+// Drop half of b->arg elements, one array_remove_at at a time or in one array_remove_if pass
+static int bench_array_filter(bench_t *b, bool bulk) {
+    array_t array = array_new(NULL);
+    void **elements = (void **)malloc(sizeof(void *) * b->arg);
+    for (int i = 0; i < b->arg; i++) {
+        elements[i] = (void *)(uintptr_t)i;
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        bench_stop_timer(b);
+        array_clear(array);
+        array_push_many(array, elements, b->arg);
+        bench_start_timer(b);
+        if (bulk) {
+            array_remove_if(array, bench_array_is_odd, NULL);
+        }
+        else {
+            for (int j = array_count(array) - 1; j >= 0; j--) {
+                if (bench_array_is_odd(array_at(array, j), NULL)) {
+                    array_remove_at(array, j);
+                }
+            }
+        }
+    }
+    bench_stop_timer(b);
+    int ret = (array_count(array) == (b->arg + 1) / 2) ? 0 : -1;
+    free(elements);
+    array_free(array);
+    return ret;
+}
+
+int bench_array_remove_each(bench_t *b) {
+    return bench_array_filter(b, false);
+}
+
+int bench_array_remove_if(bench_t *b) {
+    return bench_array_filter(b, true);
+}
+
+// Drop the first half of b->arg elements, one at a time or as a range
+static int bench_array_drop(bench_t *b, bool bulk) {
+    array_t array = array_new(NULL);
+    void **elements = (void **)malloc(sizeof(void *) * b->arg);
+    for (int i = 0; i < b->arg; i++) {
+        elements[i] = (void *)(uintptr_t)i;
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        bench_stop_timer(b);
+        array_clear(array);
+        array_push_many(array, elements, b->arg);
+        bench_start_timer(b);
+        if (bulk) {
+            array_remove_range(array, 0, b->arg / 2);
+        }
+        else {
+            for (int j = 0; j < b->arg / 2; j++) {
+                array_remove_at(array, 0);
+            }
+        }
+    }
+    bench_stop_timer(b);
+    int ret = ((uintptr_t)array_at(array, 0) == (uintptr_t)(b->arg / 2)) ? 0 : -1;
+    free(elements);
+    array_free(array);
+    return ret;
+}
+
+int bench_array_remove_head(bench_t *b) {
+    return bench_array_drop(b, false);
+}
+
+int bench_array_remove_range(bench_t *b) {
+    return bench_array_drop(b, true);
+}
@@ -0,0 +1,365 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "bench.h"
+
+// Stream b->arg bytes at a time into a buffer, 64 KB per round
+int bench_buffer_append(bench_t *b) {
+    unsigned char chunk[256];
+    memset(chunk, 0xA5, sizeof(chunk));
+    int per_round = 65536 / b->arg;
+    buffer_t buffer = NULL;
+    for (int i = 0; i < b->n; i++) {
+        if (!(i % per_round)) {
+            buffer_free(buffer);
+            buffer = buffer_new(0);
+        }
+        if (buffer_append(buffer, chunk, b->arg)) {
+            return -1;
+        }
+    }
+    bench_sink = buffer_get_length(buffer);
+    buffer_free(buffer);
+    return 0;
+}
+
+// Grow and shrink a buffer between 0 and 4 KB
+int bench_buffer_resize(bench_t *b) {
+    buffer_t buffer = buffer_new(0);
+    for (int i = 0; i < b->n; i++) {
+        if (buffer_resize(buffer, (i * 97) % 4096)) {
+            return -1;
+        }
+    }
+    buffer_free(buffer);
+    return 0;
+}
+
+int bench_buffer_new_free(bench_t *b) {
+    for (int i = 0; i < b->n; i++) {
+        buffer_t buffer = buffer_new(b->arg);
+        bench_sink = (uintptr_t)buffer_get_data(buffer);
+        buffer_free(buffer);
+    }
+    return 0;
+}
+
+int bench_buffer_clone(bench_t *b) {
+    unsigned char data[256];
+    memset(data, 0x5A, sizeof(data));
+    buffer_t buffer = buffer_new(0);
+    buffer_append(buffer, data, b->arg);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        buffer_t clone = buffer_clone(buffer);
+        if (buffer_get_length(clone) != b->arg) {
+            return -1;
+        }
+        buffer_free(clone);
+    }
+    bench_stop_timer(b);
+    buffer_free(buffer);
+    return 0;
+}
+
+// Extract b->arg bytes fields out of a received frame, by copy
+int bench_buffer_copy_field(bench_t *b) {
+    buffer_t frame = buffer_new(0);
+    unsigned char data[1024];
+    memset(data, 0, sizeof(data));
+    buffer_append(frame, data, sizeof(data));
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        int offset = (i * b->arg) % (1024 - b->arg);
+        buffer_t field = buffer_new(b->arg);
+        buffer_append(field, buffer_get_data(frame) + offset, b->arg);
+        bench_sink = buffer_get_data(field)[0];
+        buffer_free(field);
+    }
+    bench_stop_timer(b);
+    buffer_free(frame);
+    return 0;
+}
+
+// Same as above, with slices
+int bench_buffer_slice_field(bench_t *b) {
+    buffer_t frame = buffer_new(0);
+    unsigned char data[1024];
+    memset(data, 0, sizeof(data));
+    buffer_append(frame, data, sizeof(data));
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        int offset = (i * b->arg) % (1024 - b->arg);
+        buffer_t field = buffer_slice(frame, offset, b->arg);
+        bench_sink = buffer_get_data(field)[0];
+        buffer_free(field);
+    }
+    bench_stop_timer(b);
+    buffer_free(frame);
+    return 0;
+}
+
+// Assemble a message from a header, b->arg 256 bytes payloads and a trailer
+static int bench_buffer_payloads(buffer_t *payloads, int count) {
+    unsigned char data[256];
+    memset(data, 0x3C, sizeof(data));
+    for (int i = 0; i < count; i++) {
+        if (!(payloads[i] = buffer_new(0)) || buffer_append(payloads[i], data, sizeof(data))) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int bench_buffer_assemble(bench_t *b) {
+    buffer_t payloads[b->arg];
+    if (bench_buffer_payloads(payloads, b->arg)) {
+        return -1;
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        buffer_t message = buffer_new(0);
+        buffer_append_string(message, "header----------");
+        for (int j = 0; j < b->arg; j++) {
+            buffer_append_buffer(message, payloads[j]);
+        }
+        buffer_append_string(message, "trailer---------");
+        bench_sink = buffer_get_length(message);
+        buffer_free(message);
+    }
+    bench_stop_timer(b);
+    for (int i = 0; i < b->arg; i++) {
+        buffer_free(payloads[i]);
+    }
+    return 0;
+}
+
+int bench_buffer_chain_assemble(bench_t *b) {
+    buffer_t payloads[b->arg];
+    if (bench_buffer_payloads(payloads, b->arg)) {
+        return -1;
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        buffer_chain_t chain = buffer_chain_new();
+        buffer_chain_append_string(chain, "header----------");
+        for (int j = 0; j < b->arg; j++) {
+            buffer_chain_append_buffer(chain, payloads[j]);
+        }
+        buffer_chain_append_string(chain, "trailer---------");
+        // Write out segment by segment
+        int length = 0;
+        buffer_segment_t segment;
+        buffer_chain_iterator_t iterator;
+        buffer_chain_iterator_init(&iterator, chain);
+        while (buffer_chain_next_segment(&iterator, &segment)) {
+            length += segment.length;
+        }
+        if (length != 32 + 256 * b->arg) {
+            return -1;
+        }
+        buffer_chain_free(chain);
+    }
+    bench_stop_timer(b);
+    for (int i = 0; i < b->arg; i++) {
+        buffer_free(payloads[i]);
+    }
+    return 0;
+}
+
+static unsigned char *bench_buffer_binary(int len) {
+    unsigned char *data = (unsigned char *)malloc(len);
+    for (int i = 0; i < len; i++) {
+        data[i] = (unsigned char)(i * 73 + 11);
+    }
+    return data;
+}
+
+// Hex encode b->arg bytes one sprintf per byte, as call sites used to
+int bench_buffer_hex_sprintf(bench_t *b) {
+    unsigned char *data = bench_buffer_binary(b->arg);
+    buffer_t buffer = buffer_new(b->arg * 2);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        char hex[3];
+        buffer_reset(buffer);
+        for (int j = 0; j < b->arg; j++) {
+            sprintf(hex, "%02x", data[j]);
+            buffer_append(buffer, (const unsigned char *)hex, 2);
+        }
+    }
+    bench_stop_timer(b);
+    bench_sink = buffer_get_length(buffer);
+    buffer_free(buffer);
+    free(data);
+    return 0;
+}
+
+// Encode then decode b->arg bytes, only the selected direction is timed
+static int bench_buffer_codec(bench_t *b, bool decode,
+                              int (*encode_func)(buffer_t, const unsigned char *, int),
+                              int (*decode_func)(buffer_t, const char *, int)) {
+    int ret = 0;
+    unsigned char *data = bench_buffer_binary(b->arg);
+    buffer_t encoded = buffer_new(0);
+    buffer_t decoded = buffer_new(b->arg);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        if (decode) {
+            bench_stop_timer(b);
+        }
+        buffer_reset(encoded);
+        encode_func(encoded, data, b->arg);
+        if (decode) {
+            bench_start_timer(b);
+        }
+        else {
+            bench_stop_timer(b);
+        }
+        buffer_reset(decoded);
+        decode_func(decoded, (const char *)buffer_get_data(encoded), buffer_get_length(encoded));
+        if (!decode) {
+            bench_start_timer(b);
+        }
+    }
+    bench_stop_timer(b);
+    if (buffer_get_length(decoded) != b->arg || memcmp(buffer_get_data(decoded), data, b->arg)) {
+        ret = -1;
+    }
+    buffer_free(encoded);
+    buffer_free(decoded);
+    free(data);
+    return ret;
+}
+
+int bench_buffer_hex_encode(bench_t *b) {
+    return bench_buffer_codec(b, false, buffer_append_hex, buffer_append_from_hex);
+}
+
+int bench_buffer_hex_decode(bench_t *b) {
+    return bench_buffer_codec(b, true, buffer_append_hex, buffer_append_from_hex);
+}
+
+int bench_buffer_base64_encode(bench_t *b) {
+    return bench_buffer_codec(b, false, buffer_append_base64, buffer_append_from_base64);
+}
+
+int bench_buffer_base64_decode(bench_t *b) {
+    return bench_buffer_codec(b, true, buffer_append_base64, buffer_append_from_base64);
+}
+
+// A stream of b->arg frames: type, 16-bit big endian id, varint length and payload
+static buffer_t bench_buffer_frames(int count, uint32_t *expected) {
+    buffer_t stream = buffer_new(0);
+    unsigned char payload[200];
+    memset(payload, 0x5A, sizeof(payload));
+    *expected = 0;
+    for (int i = 0; i < count; i++) {
+        int len = (i * 37) % sizeof(payload);
+        unsigned char header[5] = { (unsigned char)(i & 3), (unsigned char)(i >> 8), (unsigned char)i };
+        int header_len = 3;
+        header[header_len++] = (unsigned char)(len | (len >= 0x80 ? 0x80 : 0));
+        if (len >= 0x80) {
+            header[header_len++] = (unsigned char)(len >> 7);
+        }
+        buffer_append(stream, header, header_len);
+        buffer_append(stream, payload, len);
+        *expected += i + len;
+    }
+    return stream;
+}
+
+// Parse the frames by indexing the data, copying each payload out
+int bench_buffer_parse_copy(bench_t *b) {
+    uint32_t expected;
+    buffer_t stream = bench_buffer_frames(b->arg, &expected);
+    const unsigned char *data = buffer_get_data(stream);
+    int length = buffer_get_length(stream);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        uint32_t sum = 0;
+        int pos = 0;
+        while (pos < length) {
+            if (length - pos < 3) {
+                return -1;
+            }
+            bench_sink += data[pos];
+            sum += (data[pos + 1] << 8) | data[pos + 2];
+            pos += 3;
+            uint32_t len = 0;
+            for (int shift = 0; ; shift += 7) {
+                if (pos == length || shift > 28) {
+                    return -1;
+                }
+                len |= (data[pos] & 0x7F) << shift;
+                if (!(data[pos++] & 0x80)) {
+                    break;
+                }
+            }
+            if (len > (uint32_t)(length - pos)) {
+                return -1;
+            }
+            buffer_t payload = buffer_new(len);
+            buffer_append(payload, data + pos, len);
+            sum += buffer_get_length(payload);
+            buffer_free(payload);
+            pos += len;
+        }
+        if (sum != expected) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    buffer_free(stream);
+    return 0;
+}
+
+// Same as above with a reader, payloads are used in place
+int bench_buffer_parse_reader(bench_t *b) {
+    uint32_t expected;
+    buffer_t stream = bench_buffer_frames(b->arg, &expected);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        buffer_reader_t reader;
+        uint32_t sum = 0;
+        buffer_reader_init(&reader, stream);
+        while (buffer_reader_remaining(&reader) && !buffer_reader_error(&reader)) {
+            int len;
+            bench_sink += buffer_reader_u8(&reader);
+            sum += buffer_reader_u16_be(&reader);
+            bench_sink += buffer_reader_field(&reader, BUFFER_READER_PREFIX_VARINT, &len) != NULL;
+            sum += len;
+        }
+        if (buffer_reader_error(&reader) || sum != expected) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    buffer_free(stream);
+    return 0;
+}
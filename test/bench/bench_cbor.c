@@ -0,0 +1,268 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+// State as it would be persisted: count fields with short string values
+static map_t bench_cbor_state(int count) {
+    map_t map = map_new(free);
+    char key[16];
+    char value[32];
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "field%d", i);
+        snprintf(value, sizeof(value), "value %d of %d", i * 7919, count);
+        map_set_value_for_key(map, key, strdup(value));
+    }
+    return map;
+}
+
+// The JSON we used to hand-roll, without any escaping
+static int bench_cbor_json_encode(buffer_t buffer, map_t map) {
+    array_t keys = map_keys(map);
+    array_t values = map_values(map);
+    char line[128];
+    buffer_append_string(buffer, "{");
+    for (int i = 0; i < array_count(keys); i++) {
+        snprintf(line, sizeof(line), "%s\"%s\":\"%s\"", i ? "," : "",
+            (const char *)array_at(keys, i), (const char *)array_at(values, i));
+        if (buffer_append_string(buffer, line)) {
+            return -1;
+        }
+    }
+    return buffer_append_string(buffer, "}");
+}
+
+static map_t bench_cbor_json_decode(const char *json) {
+    map_t map = map_new(free);
+    const char *p = json;
+    while ((p = strchr(p, '"'))) {
+        const char *key = p + 1;
+        const char *key_end = strchr(key, '"');
+        const char *value = strchr(key_end + 1, '"') + 1;
+        const char *value_end = strchr(value, '"');
+        char *k = strndup(key, key_end - key);
+        map_set_value_for_key(map, k, strndup(value, value_end - value));
+        free(k);
+        p = value_end + 1;
+    }
+    return map;
+}
+
+static bool bench_cbor_same_state(map_t a, map_t b) {
+    if (!b || map_count(a) != map_count(b)) {
+        return false;
+    }
+    map_iterator_t iterator;
+    map_iterator_init(&iterator, a);
+    while (map_iterator_next(&iterator)) {
+        const char *value = (const char *)map_value_for_key(b, iterator.key);
+        if (!value || strcmp(value, (const char *)iterator.value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Encode a state of b->arg fields. Sizes for 32 fields: 838 bytes of CBOR, 965 of JSON
+int bench_cbor_encode(bench_t *b) {
+    map_t map = bench_cbor_state(b->arg);
+    buffer_t buffer = buffer_new(0);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        buffer_reset(buffer);
+        if (cbor_append_map(buffer, map)) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    bench_sink = buffer_get_length(buffer);
+    buffer_free(buffer);
+    map_free(map);
+    return 0;
+}
+
+int bench_cbor_json_encode_state(bench_t *b) {
+    map_t map = bench_cbor_state(b->arg);
+    buffer_t buffer = buffer_new(0);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        buffer_reset(buffer);
+        if (bench_cbor_json_encode(buffer, map)) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    bench_sink = buffer_get_length(buffer);
+    buffer_free(buffer);
+    map_free(map);
+    return 0;
+}
+
+int bench_cbor_decode(bench_t *b) {
+    map_t map = bench_cbor_state(b->arg);
+    buffer_t buffer = buffer_new(0);
+    cbor_append_map(buffer, map);
+    int ret = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        cbor_type_t type;
+        void *decoded = NULL;
+        if (cbor_decode(buffer_get_data(buffer), buffer_get_length(buffer), &type, &decoded) || type != CBOR_TYPE_MAP) {
+            return -1;
+        }
+        bench_stop_timer(b);
+        if (!i && !bench_cbor_same_state(map, decoded)) {
+            ret = -1;
+        }
+        bench_start_timer(b);
+        map_free(decoded);
+    }
+    bench_stop_timer(b);
+    buffer_free(buffer);
+    map_free(map);
+    return ret;
+}
+
+int bench_cbor_json_decode_state(bench_t *b) {
+    map_t map = bench_cbor_state(b->arg);
+    buffer_t buffer = buffer_new(0);
+    bench_cbor_json_encode(buffer, map);
+    int ret = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        map_t decoded = bench_cbor_json_decode((const char *)buffer_get_data(buffer));
+        bench_stop_timer(b);
+        if (!i && !bench_cbor_same_state(map, decoded)) {
+            ret = -1;
+        }
+        bench_start_timer(b);
+        map_free(decoded);
+    }
+    bench_stop_timer(b);
+    buffer_free(buffer);
+    map_free(map);
+    return ret;
+}
+
+static int bench_cbor_count_field(void *context, const cbor_item_t *item) {
+    if (item->key && item->key_length == 7 && !memcmp(item->key, "field17", 7)) {
+        (*(int *)context)++;
+    }
+    return UTILS_ERR_OK;
+}
+
+// Look for one field without decoding anything
+int bench_cbor_visit(bench_t *b) {
+    map_t map = bench_cbor_state(b->arg);
+    buffer_t buffer = buffer_new(0);
+    cbor_append_map(buffer, map);
+    int found = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        if (cbor_visit(buffer_get_data(buffer), buffer_get_length(buffer), bench_cbor_count_field, &found)) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    buffer_free(buffer);
+    map_free(map);
+    return found == (b->arg > 17 ? b->n : 0) ? 0 : -1;
+}
+
+// Every type nested, which must encode to the same bytes once decoded
+static map_t bench_cbor_nested(void) {
+    map_t root = map_new(map_free);
+    map_t numbers = map_new(cbor_uint_free);
+    map_t strings = bench_cbor_state(8);
+    map_t lists = map_new(array_free);
+    array_t buffers = array_new(buffer_free);
+    array_t mpis = array_new(utils_mpi_free);
+    array_t matrix = array_new(array_free);
+    unsigned char bytes[64];
+    for (int i = 0; i < (int)sizeof(bytes); i++) {
+        bytes[i] = (unsigned char)(i * 37 + 1);
+    }
+    map_set_value_for_key(numbers, "zero", (void *)0);
+    map_set_value_for_key(numbers, "small", (void *)23);
+    map_set_value_for_key(numbers, "byte", (void *)255);
+    map_set_value_for_key(numbers, "large", (void *)(uintptr_t)UINT32_MAX);
+    map_set_value_for_key(strings, "empty", strdup(""));
+    map_set_value_for_key(strings, "none", NULL);
+    for (int i = 0; i < 4; i++) {
+        buffer_t buffer = buffer_new(0);
+        buffer_append(buffer, bytes, i * 20);
+        array_push(buffers, buffer);
+        mbedtls_mpi *mpi = utils_mpi_new();
+        mbedtls_mpi_read_binary(mpi, bytes, i * 16);
+        array_push(mpis, mpi);
+        array_t row = array_new(cbor_uint_free);
+        for (int j = 0; j < i; j++) {
+            array_push(row, (void *)(uintptr_t)(i * j * 1000));
+        }
+        array_push(matrix, row);
+    }
+    array_push(matrix, NULL);
+    map_set_value_for_key(lists, "buffers", buffers);
+    map_set_value_for_key(lists, "mpis", mpis);
+    map_set_value_for_key(lists, "matrix", matrix);
+    map_set_value_for_key(lists, "empty", array_new(NULL));
+    map_set_value_for_key(root, "numbers", numbers);
+    map_set_value_for_key(root, "strings", strings);
+    map_set_value_for_key(root, "lists", lists);
+    map_set_value_for_key(root, "nothing", map_new(NULL));
+    return root;
+}
+
+int bench_cbor_round_trip(bench_t *b) {
+    map_t map = bench_cbor_nested();
+    buffer_t encoded = buffer_new(0);
+    buffer_t again = buffer_new(0);
+    int ret = 0;
+    cbor_append_map(encoded, map);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n && !ret; i++) {
+        cbor_type_t type;
+        void *decoded = NULL;
+        buffer_reset(again);
+        if (cbor_decode(buffer_get_data(encoded), buffer_get_length(encoded), &type, &decoded) ||
+            type != CBOR_TYPE_MAP || cbor_append_map(again, decoded) ||
+            buffer_get_length(again) != buffer_get_length(encoded) ||
+            memcmp(buffer_get_data(again), buffer_get_data(encoded), buffer_get_length(encoded))) {
+            ret = -1;
+        }
+        map_free(decoded);
+    }
+    bench_stop_timer(b);
+    buffer_free(encoded);
+    buffer_free(again);
+    map_free(map);
+    return ret;
+}
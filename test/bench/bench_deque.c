@@ -0,0 +1,82 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include "bench.h"
+
+// Same as array/remove_front: fill the queue, then drain it from the front
+int bench_deque_remove_front(bench_t *b) {
+    deque_t deque = deque_new(NULL);
+    for (int i = 0; i < b->n; i++) {
+        deque_push_back(deque, (void *)(uintptr_t)i);
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        if ((uintptr_t)deque_pop_front(deque) != i) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    deque_free(deque);
+    return 0;
+}
+
+// A work queue holding b->arg items, one enqueued and one dequeued per operation
+int bench_deque_queue_array(bench_t *b) {
+    array_t array = array_new(NULL);
+    for (int i = 0; i < b->arg; i++) {
+        array_push(array, (void *)(uintptr_t)i);
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        array_push(array, (void *)(uintptr_t)(i + b->arg));
+        if ((uintptr_t)array_remove_at(array, 0) != i) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    array_free(array);
+    return 0;
+}
+
+int bench_deque_queue_deque(bench_t *b) {
+    deque_t deque = deque_new(NULL);
+    for (int i = 0; i < b->arg; i++) {
+        deque_push_back(deque, (void *)(uintptr_t)i);
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        deque_push_back(deque, (void *)(uintptr_t)(i + b->arg));
+        if ((uintptr_t)deque_pop_front(deque) != i) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    deque_free(deque);
+    return 0;
+}
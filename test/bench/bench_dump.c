@@ -0,0 +1,101 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "bench.h"
+
+// Dump b->arg bytes of mixed binary and text per operation
+int bench_dump_data(bench_t *b) {
+    unsigned char *data = (unsigned char *)malloc(b->arg);
+    for (int i = 0; i < b->arg; i++) {
+        data[i] = (unsigned char)(i * 31);
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        dump_data(data, b->arg, "bench");
+    }
+    bench_stop_timer(b);
+    free(data);
+    return 0;
+}
+
+static void bench_dump_null_sink(void *context, const char *data, size_t len) {
+    *(size_t *)context += len;
+    bench_sink += (uintptr_t)data[0];
+}
+
+// Same as above through a sink that only counts bytes, to time the formatting alone
+int bench_dump_data_sink(bench_t *b) {
+    unsigned char *data = (unsigned char *)malloc(b->arg);
+    for (int i = 0; i < b->arg; i++) {
+        data[i] = (unsigned char)(i * 31);
+    }
+    size_t total = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        dump_data_to(bench_dump_null_sink, &total, data, b->arg, "bench");
+    }
+    bench_stop_timer(b);
+    free(data);
+    // Description, one line per 16 bytes and the trailer
+    size_t lines = (b->arg + 15) / 16;
+    size_t expected = 6 + lines * 53 + b->arg + lines * 2 + 4;
+    return (total == expected * (size_t)b->n) ? 0 : -1;
+}
+
+// Time spent by the caller of dump_data in asynchronous mode. The queue is flushed outside of the
+// timer before it fills, so that every dump is accepted
+int bench_dump_async(bench_t *b) {
+    unsigned char *data = (unsigned char *)malloc(b->arg);
+    for (int i = 0; i < b->arg; i++) {
+        data[i] = (unsigned char)(i * 31);
+    }
+    size_t total = 0;
+    dump_set_sink(bench_dump_null_sink, &total);
+    if (dump_async_start() != UTILS_ERR_OK) {
+        return -1;
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        if (i % (UTILS_DUMP_ASYNC_SLOTS / 2) == 0) {
+            bench_stop_timer(b);
+            dump_async_flush();
+            bench_start_timer(b);
+        }
+        dump_data(data, b->arg, "bench");
+    }
+    bench_stop_timer(b);
+    dump_async_flush();
+    dump_async_stats_t stats;
+    dump_async_get_stats(&stats);
+    dump_async_stop();
+    dump_set_sink(NULL, NULL);
+    free(data);
+    size_t lines = (b->arg + 15) / 16;
+    size_t expected = 6 + lines * 53 + b->arg + lines * 2 + 4;
+    return (stats.written == (uint32_t)b->n && !stats.dropped && total == expected * (size_t)b->n) ? 0 : -1;
+}
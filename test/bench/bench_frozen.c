@@ -0,0 +1,157 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifndef ESP_PLATFORM
+#include <unistd.h>
+#endif
+#include "bench.h"
+
+static void bench_frozen_entry(int i, char *key, char *value) {
+    sprintf(key, "sensor/%d/calibration", i);
+    sprintf(value, "offset=%d;gain=%d", i * 7, i * 13);
+}
+
+// The table as it is built at boot, one entry at a time
+static map_t bench_frozen_map(int count) {
+    map_t map = map_new(buffer_free);
+    char key[48];
+    char value[48];
+    for (int i = 0; i < count; i++) {
+        bench_frozen_entry(i, key, value);
+        map_set_value_for_key(map, key, buffer_new_from_string(strdup(value)));
+    }
+    return map;
+}
+
+static bool bench_frozen_check(const unsigned char *data, int len, int i) {
+    char key[48];
+    char value[48];
+    bench_frozen_entry(i, key, value);
+    return data && len == strlen(value) && !memcmp(data, value, len);
+}
+
+int bench_frozen_startup_map(bench_t *b) {
+    for (int i = 0; i < b->n; i++) {
+        map_t map = bench_frozen_map(b->arg);
+        bench_sink += map_count(map);
+        map_free(map);
+    }
+    return 0;
+}
+
+// Open a blob of b->arg entries, from a mapped file on Linux
+int bench_frozen_startup_blob(bench_t *b) {
+    map_t map = bench_frozen_map(b->arg);
+    buffer_t blob = buffer_new(0);
+    int ret = 0;
+    if (frozen_map_freeze(map, blob)) {
+        return -1;
+    }
+#ifndef ESP_PLATFORM
+    char path[] = "/tmp/utils_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, buffer_get_data(blob), buffer_get_length(blob)) != buffer_get_length(blob)) {
+        return -1;
+    }
+    close(fd);
+#endif
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n && !ret; i++) {
+        frozen_map_t frozen;
+        const unsigned char *data;
+        int len;
+#ifndef ESP_PLATFORM
+        ret = frozen_map_open_file(&frozen, path);
+#else
+        ret = frozen_map_open(&frozen, buffer_get_data(blob), buffer_get_length(blob));
+#endif
+        if (!ret) {
+            data = frozen_map_value_for_key(&frozen, "sensor/0/calibration", &len);
+            if (!bench_frozen_check(data, len, 0)) {
+                ret = -1;
+            }
+            frozen_map_close(&frozen);
+        }
+    }
+    bench_stop_timer(b);
+#ifndef ESP_PLATFORM
+    unlink(path);
+#endif
+    buffer_free(blob);
+    map_free(map);
+    return ret ? -1 : 0;
+}
+
+// Look up every key of a table of b->arg entries, in a map_t or in place in the blob
+static int bench_frozen_lookup(bench_t *b, bool frozen) {
+    map_t map = bench_frozen_map(b->arg);
+    buffer_t blob = buffer_new(0);
+    frozen_map_t frozen_map;
+    char keys[b->arg][48];
+    char value[48];
+    if (frozen_map_freeze(map, blob) || frozen_map_open(&frozen_map, buffer_get_data(blob), buffer_get_length(blob))) {
+        return -1;
+    }
+    for (int i = 0; i < b->arg; i++) {
+        bench_frozen_entry(i, keys[i], value);
+    }
+    int ret = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        int index = i % b->arg;
+        const unsigned char *data;
+        int len;
+        if (frozen) {
+            data = frozen_map_value_for_key(&frozen_map, keys[index], &len);
+        }
+        else {
+            buffer_t buffer = (buffer_t)map_value_for_key(map, keys[index]);
+            data = buffer_get_data(buffer);
+            len = buffer_get_length(buffer);
+        }
+        if (!index && !bench_frozen_check(data, len, 0)) {
+            ret = -1;
+        }
+        bench_sink += len;
+    }
+    bench_stop_timer(b);
+    buffer_free(blob);
+    map_free(map);
+    return ret;
+}
+
+int bench_frozen_lookup_map(bench_t *b) {
+    return bench_frozen_lookup(b, false);
+}
+
+int bench_frozen_lookup_blob(bench_t *b) {
+    return bench_frozen_lookup(b, true);
+}
@@ -0,0 +1,326 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdatomic.h>
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "bench.h"
+
+#define BENCH_MAP_KEY_SIZE          24
+#define BENCH_MAP_SHARED_KEYS       64
+#define BENCH_MAP_TASK_STACK        4096
+#define BENCH_MAP_TASK_PRIORITY     5
+
+// Keys are stored in one block, followed by the pointers to them
+static char **bench_map_keys(int count, const char *prefix) {
+    char *block = (char *)malloc((BENCH_MAP_KEY_SIZE + sizeof(char *)) * count);
+    if (!block) {
+        return NULL;
+    }
+    char **keys = (char **)(block + BENCH_MAP_KEY_SIZE * count);
+    for (int i = 0; i < count; i++) {
+        keys[i] = block + BENCH_MAP_KEY_SIZE * i;
+        snprintf(keys[i], BENCH_MAP_KEY_SIZE, "%s%d", prefix, i);
+    }
+    return keys;
+}
+
+static void bench_map_keys_free(char **keys) {
+    if (keys) {
+        free(keys[0]);
+    }
+}
+
+static map_t bench_map_fill(char **keys, int count) {
+    map_t map = map_new(NULL);
+    for (int i = 0; i < count; i++) {
+        map_set_value_for_key(map, keys[i], (void *)(uintptr_t)(i + 1));
+    }
+    return map;
+}
+
+// Fill maps of b->arg entries from scratch
+int bench_map_set(bench_t *b) {
+    char **keys = bench_map_keys(b->arg, "key-");
+    if (!keys) {
+        return -1;
+    }
+    b->n = (b->n + b->arg - 1) / b->arg * b->arg;
+    bench_reset_timer(b);
+    for (int done = 0; done < b->n; done += b->arg) {
+        map_t map = bench_map_fill(keys, b->arg);
+        map_free(map);
+    }
+    bench_stop_timer(b);
+    bench_map_keys_free(keys);
+    return 0;
+}
+
+int bench_map_get(bench_t *b) {
+    char **keys = bench_map_keys(b->arg, "key-");
+    if (!keys) {
+        return -1;
+    }
+    map_t map = bench_map_fill(keys, b->arg);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        int index = i % b->arg;
+        if ((uintptr_t)map_value_for_key(map, keys[index]) != index + 1) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    map_free(map);
+    bench_map_keys_free(keys);
+    return 0;
+}
+
+int bench_map_get_missing(bench_t *b) {
+    char **keys = bench_map_keys(b->arg, "key-");
+    char **missing = bench_map_keys(b->arg, "missing-");
+    if (!keys || !missing) {
+        return -1;
+    }
+    map_t map = bench_map_fill(keys, b->arg);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        if (map_value_for_key(map, missing[i % b->arg])) {
+            return -1;
+        }
+    }
+    bench_stop_timer(b);
+    map_free(map);
+    bench_map_keys_free(keys);
+    bench_map_keys_free(missing);
+    return 0;
+}
+
+// Empty maps of b->arg entries, one key at a time, oldest first
+int bench_map_remove(bench_t *b) {
+    char **keys = bench_map_keys(b->arg, "key-");
+    if (!keys) {
+        return -1;
+    }
+    b->n = (b->n + b->arg - 1) / b->arg * b->arg;
+    bench_reset_timer(b);
+    for (int done = 0; done < b->n; done += b->arg) {
+        bench_stop_timer(b);
+        map_t map = bench_map_fill(keys, b->arg);
+        bench_start_timer(b);
+        for (int i = 0; i < b->arg; i++) {
+            if ((uintptr_t)map_remove_value_for_key(map, keys[i]) != i + 1) {
+                return -1;
+            }
+        }
+        bench_stop_timer(b);
+        map_free(map);
+    }
+    bench_map_keys_free(keys);
+    return 0;
+}
+
+static const char *bench_map_common_keys[] = { "id", "type", "session", "nonce", "status", "payload", "signature", "salt" };
+
+// Build b->arg small maps sharing the same 8 keys, from a pool if it isn't NULL
+static int bench_map_common(bench_t *b, intern_pool_t pool) {
+    map_t maps[b->arg];
+    for (int done = 0; done < b->n; done += b->arg) {
+        for (int i = 0; i < b->arg; i++) {
+            maps[i] = pool ? map_new_with_pool(pool, NULL) : map_new(NULL);
+            for (int j = 0; j < 8; j++) {
+                map_set_value_for_key(maps[i], bench_map_common_keys[j], (void *)(uintptr_t)(j + 1));
+            }
+        }
+        for (int i = 0; i < b->arg; i++) {
+            if ((uintptr_t)map_value_for_key(maps[i], "session") != 3) {
+                return -1;
+            }
+            map_free(maps[i]);
+        }
+    }
+    return 0;
+}
+
+int bench_map_common_keys_strdup(bench_t *b) {
+    return bench_map_common(b, NULL);
+}
+
+int bench_map_common_keys_pool(bench_t *b) {
+    intern_pool_t pool = intern_pool_new();
+    // Keep the keys alive between rounds, as long-lived maps would
+    for (int j = 0; j < 8; j++) {
+        intern_pool_acquire(pool, bench_map_common_keys[j]);
+    }
+    bench_reset_timer(b);
+    int ret = bench_map_common(b, pool);
+    bench_stop_timer(b);
+    intern_pool_free(pool);
+    return ret;
+}
+
+// Lookups shared by b->arg tasks, on a map behind a mutex or on a concurrent map
+typedef struct {
+    char **keys;
+    int lookups;
+    map_t map;
+    SemaphoreHandle_t lock;
+    concurrent_map_t concurrent_map;
+    atomic_bool stop;
+    atomic_int done;
+    atomic_int errors;
+} bench_map_shared_t;
+
+static void bench_map_shared_task(void *p) {
+    bench_map_shared_t *shared = (bench_map_shared_t *)p;
+    int errors = 0;
+    for (int i = 0; i < shared->lookups; i++) {
+        int key = i % BENCH_MAP_SHARED_KEYS;
+        void *value;
+        if (shared->concurrent_map) {
+            int token = concurrent_map_read_begin(shared->concurrent_map);
+            value = concurrent_map_value_for_key(shared->concurrent_map, shared->keys[key]);
+            concurrent_map_read_end(shared->concurrent_map, token);
+        }
+        else {
+            xSemaphoreTake(shared->lock, portMAX_DELAY);
+            value = map_value_for_key(shared->map, shared->keys[key]);
+            xSemaphoreGive(shared->lock);
+        }
+        errors += (value != (void *)(uintptr_t)(key + 1));
+    }
+    atomic_fetch_add(&shared->errors, errors);
+    atomic_fetch_add(&shared->done, 1);
+    vTaskDelete(NULL);
+}
+
+static int bench_map_shared(bench_t *b, bool concurrent) {
+    bench_map_shared_t shared = { 0 };
+    if (!(shared.keys = bench_map_keys(BENCH_MAP_SHARED_KEYS, "config.key."))) {
+        return -1;
+    }
+    shared.lookups = b->n / b->arg;
+    if (concurrent) {
+        shared.concurrent_map = concurrent_map_new(NULL);
+        for (int i = 0; i < BENCH_MAP_SHARED_KEYS; i++) {
+            concurrent_map_set_value_for_key(shared.concurrent_map, shared.keys[i], (void *)(uintptr_t)(i + 1));
+        }
+    }
+    else {
+        shared.map = bench_map_fill(shared.keys, BENCH_MAP_SHARED_KEYS);
+        shared.lock = xSemaphoreCreateMutex();
+    }
+    atomic_init(&shared.done, 0);
+    atomic_init(&shared.errors, 0);
+    int tasks = 0;
+    bench_reset_timer(b);
+    for (; tasks < b->arg; tasks++) {
+        if (xTaskCreate(bench_map_shared_task, "bench_map", BENCH_MAP_TASK_STACK, &shared, BENCH_MAP_TASK_PRIORITY, NULL) != pdPASS) {
+            break;
+        }
+    }
+    while (atomic_load(&shared.done) < tasks) {
+        vTaskDelay(1);
+    }
+    bench_stop_timer(b);
+    if (concurrent) {
+        concurrent_map_free(shared.concurrent_map);
+    }
+    else {
+        map_free(shared.map);
+        vSemaphoreDelete(shared.lock);
+    }
+    bench_map_keys_free(shared.keys);
+    return (tasks == b->arg && !atomic_load(&shared.errors)) ? 0 : -1;
+}
+
+// Readers of the concurrent map that keep going until the writer is done
+static void bench_map_reader_task(void *p) {
+    bench_map_shared_t *shared = (bench_map_shared_t *)p;
+    int errors = 0;
+    for (int i = 0; !atomic_load(&shared->stop); i++) {
+        int key = i % BENCH_MAP_SHARED_KEYS;
+        int token = concurrent_map_read_begin(shared->concurrent_map);
+        errors += (concurrent_map_value_for_key(shared->concurrent_map, shared->keys[key]) != (void *)(uintptr_t)(key + 1));
+        concurrent_map_read_end(shared->concurrent_map, token);
+    }
+    atomic_fetch_add(&shared->errors, errors);
+    atomic_fetch_add(&shared->done, 1);
+    vTaskDelete(NULL);
+}
+
+// Writes to a concurrent map while b->arg tasks read it, each one waits for the readers
+int bench_map_concurrent_write(bench_t *b) {
+    bench_map_shared_t shared = { 0 };
+    if (!(shared.keys = bench_map_keys(BENCH_MAP_SHARED_KEYS, "config.key."))) {
+        return -1;
+    }
+    int ret = -1;
+    if (!(shared.concurrent_map = concurrent_map_new(NULL))) {
+        goto cleanup;
+    }
+    for (int i = 0; i < BENCH_MAP_SHARED_KEYS; i++) {
+        if (concurrent_map_set_value_for_key(shared.concurrent_map, shared.keys[i], (void *)(uintptr_t)(i + 1))) {
+            goto cleanup;
+        }
+    }
+    atomic_init(&shared.stop, false);
+    atomic_init(&shared.done, 0);
+    atomic_init(&shared.errors, 0);
+    int tasks = 0;
+    for (; tasks < b->arg; tasks++) {
+        if (xTaskCreate(bench_map_reader_task, "bench_map", BENCH_MAP_TASK_STACK, &shared, BENCH_MAP_TASK_PRIORITY, NULL) != pdPASS) {
+            break;
+        }
+    }
+    int errors = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        int key = i % BENCH_MAP_SHARED_KEYS;
+        if (concurrent_map_set_value_for_key(shared.concurrent_map, shared.keys[key], (void *)(uintptr_t)(key + 1))) {
+            errors++;
+        }
+    }
+    bench_stop_timer(b);
+    atomic_store(&shared.stop, true);
+    while (atomic_load(&shared.done) < tasks) {
+        vTaskDelay(1);
+    }
+    ret = (tasks == b->arg && !errors && !atomic_load(&shared.errors)) ? 0 : -1;
+cleanup:
+    concurrent_map_free(shared.concurrent_map);
+    bench_map_keys_free(shared.keys);
+    return ret;
+}
+
+int bench_map_shared_mutex(bench_t *b) {
+    return bench_map_shared(b, false);
+}
+
+int bench_map_shared_concurrent(bench_t *b) {
+    return bench_map_shared(b, true);
+}
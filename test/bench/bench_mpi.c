@@ -0,0 +1,142 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include "bench.h"
+
+#define BENCH_MPI_TEMPORARIES       8
+
+// Create b->arg-bit temporaries the way the ECC/SRP paths do, then free them
+static int bench_mpi_temporaries(bench_t *b) {
+    mbedtls_mpi *mpis[BENCH_MPI_TEMPORARIES];
+    size_t limbs = b->arg / (sizeof(mbedtls_mpi_uint) * 8);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        for (int j = 0; j < BENCH_MPI_TEMPORARIES; j++) {
+            if (!(mpis[j] = utils_mpi_new())) {
+                return -1;
+            }
+            // What mbedtls does before writing a result
+            mbedtls_mpi_grow(mpis[j], limbs);
+            mbedtls_mpi_lset(mpis[j], j);
+        }
+        for (int j = 0; j < BENCH_MPI_TEMPORARIES; j++) {
+            bench_sink += mbedtls_mpi_get_bit(mpis[j], 0);
+            utils_mpi_free(mpis[j]);
+        }
+    }
+    bench_stop_timer(b);
+    return 0;
+}
+
+int bench_mpi_new_free_heap(bench_t *b) {
+    return bench_mpi_temporaries(b);
+}
+
+int bench_mpi_new_free_pool(bench_t *b) {
+    if (utils_mpi_pool_init(BENCH_MPI_TEMPORARIES, b->arg)) {
+        return -1;
+    }
+    int ret = bench_mpi_temporaries(b);
+    if (utils_mpi_pool_deinit()) {
+        return -1;
+    }
+    return ret;
+}
+
+static int bench_mpi_values(mbedtls_mpi **mpis, int bits) {
+    unsigned char bytes[bits / 8];
+    for (int i = 0; i < BENCH_MPI_TEMPORARIES; i++) {
+        for (int j = 0; j < bits / 8; j++) {
+            bytes[j] = (unsigned char)(i * 31 + j * 7 + 1);
+        }
+        if (!(mpis[i] = utils_mpi_new()) || mbedtls_mpi_read_binary(mpis[i], bytes, bits / 8)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void bench_mpi_free_values(mbedtls_mpi **mpis) {
+    for (int i = 0; i < BENCH_MPI_TEMPORARIES; i++) {
+        utils_mpi_free(mpis[i]);
+    }
+}
+
+int bench_mpi_buffer_new(bench_t *b) {
+    mbedtls_mpi *mpis[BENCH_MPI_TEMPORARIES];
+    if (bench_mpi_values(mpis, b->arg)) {
+        return -1;
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        buffer_t buffer = buffer_new_from_mpi(mpis[i % BENCH_MPI_TEMPORARIES]);
+        bench_sink += buffer_get_length(buffer);
+        buffer_free(buffer);
+    }
+    bench_stop_timer(b);
+    bench_mpi_free_values(mpis);
+    return 0;
+}
+
+// Serialize the MPIs of a handshake message one by one, or in one call
+static int bench_mpi_serialize(bench_t *b, bool batch) {
+    int ret = 0;
+    mbedtls_mpi *mpis[BENCH_MPI_TEMPORARIES];
+    if (bench_mpi_values(mpis, b->arg)) {
+        return -1;
+    }
+    buffer_t buffer = buffer_new(BENCH_MPI_TEMPORARIES * b->arg / 8);
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        buffer_reset(buffer);
+        if (batch) {
+            buffer_append_mpis(buffer, mpis, BENCH_MPI_TEMPORARIES, b->arg / 8);
+        }
+        else {
+            for (int j = 0; j < BENCH_MPI_TEMPORARIES; j++) {
+                buffer_append_mpi_padded(buffer, mpis[j], b->arg / 8);
+            }
+        }
+    }
+    bench_stop_timer(b);
+    if (buffer_get_length(buffer) != BENCH_MPI_TEMPORARIES * b->arg / 8) {
+        ret = -1;
+    }
+    buffer_free(buffer);
+    bench_mpi_free_values(mpis);
+    return ret;
+}
+
+int bench_mpi_append_each(bench_t *b) {
+    return bench_mpi_serialize(b, false);
+}
+
+int bench_mpi_append_batch(bench_t *b) {
+    return bench_mpi_serialize(b, true);
+}
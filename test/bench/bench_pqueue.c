@@ -0,0 +1,130 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+
+#include "bench.h"
+
+// Timers kept sorted by deadline: each operation expires the earliest and rearms it further ahead
+typedef struct {
+    uint32_t deadline;
+    int handle;
+} bench_timer_t;
+
+static int bench_pqueue_compare(const void *a, const void *b) {
+    uint32_t x = ((const bench_timer_t *)a)->deadline;
+    uint32_t y = ((const bench_timer_t *)b)->deadline;
+    return (x > y) - (x < y);
+}
+
+static bench_timer_t *bench_pqueue_timers(int count) {
+    bench_timer_t *timers = malloc(count * sizeof(bench_timer_t));
+    uint32_t seed = 1;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        timers[i].deadline = seed >> 16;
+    }
+    return timers;
+}
+
+// Linear scan for the earliest deadline, as done without a heap
+int bench_pqueue_scan_array(bench_t *b) {
+    bench_timer_t *timers = bench_pqueue_timers(b->arg);
+    array_t array = array_new(NULL);
+    for (int i = 0; i < b->arg; i++) {
+        array_push(array, &timers[i]);
+    }
+    uint32_t last = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        int first = 0;
+        for (int j = 1; j < array_count(array); j++) {
+            if (bench_pqueue_compare(array_at(array, j), array_at(array, first)) < 0) {
+                first = j;
+            }
+        }
+        bench_timer_t *timer = array_remove_at(array, first);
+        if (timer->deadline < last) {
+            return -1;
+        }
+        last = timer->deadline;
+        timer->deadline += 1000 + i % 1000;
+        array_push(array, timer);
+    }
+    bench_stop_timer(b);
+    array_free(array);
+    free(timers);
+    return 0;
+}
+
+int bench_pqueue_heap(bench_t *b) {
+    bench_timer_t *timers = bench_pqueue_timers(b->arg);
+    pqueue_t queue = pqueue_new(bench_pqueue_compare, NULL);
+    for (int i = 0; i < b->arg; i++) {
+        pqueue_push(queue, &timers[i]);
+    }
+    uint32_t last = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        bench_timer_t *timer = pqueue_pop(queue);
+        if (timer->deadline < last) {
+            return -1;
+        }
+        last = timer->deadline;
+        timer->deadline += 1000 + i % 1000;
+        pqueue_push(queue, timer);
+    }
+    bench_stop_timer(b);
+    pqueue_free(queue);
+    free(timers);
+    return 0;
+}
+
+// Rearm the top timer in place through its handle instead of popping and pushing it
+int bench_pqueue_update(bench_t *b) {
+    bench_timer_t *timers = bench_pqueue_timers(b->arg);
+    pqueue_t queue = pqueue_new(bench_pqueue_compare, NULL);
+    for (int i = 0; i < b->arg; i++) {
+        timers[i].handle = pqueue_push(queue, &timers[i]);
+    }
+    uint32_t last = 0;
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        bench_timer_t *timer = pqueue_peek(queue);
+        if (timer->deadline < last) {
+            return -1;
+        }
+        last = timer->deadline;
+        timer->deadline += 1000 + i % 1000;
+        pqueue_update(queue, timer->handle);
+    }
+    bench_stop_timer(b);
+    pqueue_free(queue);
+    free(timers);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <stdatomic.h>
+#include "freertos/task.h"
+#include "bench.h"
+
+#define BENCH_RING_CAPACITY         4096
+#define BENCH_RING_TASK_STACK       4096
+#define BENCH_RING_TASK_PRIORITY    5
+
+typedef struct {
+    ring_buffer_t ring;
+    ring_buffer_t reply;
+    int count;
+    int chunk;
+    atomic_int done;
+} bench_ring_t;
+
+// Write count chunks of a running byte sequence
+static void bench_ring_producer_task(void *p) {
+    bench_ring_t *bench = (bench_ring_t *)p;
+    unsigned char chunk[bench->chunk];
+    unsigned char seq = 0;
+    for (int i = 0; i < bench->count; i++) {
+        for (int j = 0; j < bench->chunk; j++) {
+            chunk[j] = seq++;
+        }
+        int written = 0;
+        while ((written += ring_buffer_write(bench->ring, chunk + written, bench->chunk - written)) < bench->chunk) {
+            taskYIELD();
+        }
+    }
+    atomic_store(&bench->done, 1);
+    vTaskDelete(NULL);
+}
+
+// Stream b->n chunks of b->arg bytes to a consumer that reads them in place
+int bench_ring_stream(bench_t *b) {
+    bench_ring_t bench = { .count = b->n, .chunk = b->arg };
+    if (!(bench.ring = ring_buffer_new(BENCH_RING_CAPACITY))) {
+        return -1;
+    }
+    atomic_init(&bench.done, 0);
+    int errors = 0;
+    unsigned char seq = 0;
+    int64_t left = (int64_t)b->n * b->arg;
+    bench_reset_timer(b);
+    if (xTaskCreate(bench_ring_producer_task, "bench_ring", BENCH_RING_TASK_STACK, &bench, BENCH_RING_TASK_PRIORITY, NULL) != pdPASS) {
+        ring_buffer_free(bench.ring);
+        return -1;
+    }
+    while (left) {
+        int len;
+        const unsigned char *data = ring_buffer_peek(bench.ring, &len);
+        if (!len) {
+            taskYIELD();
+            continue;
+        }
+        for (int i = 0; i < len; i++) {
+            errors += (data[i] != seq++);
+        }
+        ring_buffer_consume(bench.ring, len);
+        left -= len;
+    }
+    bench_stop_timer(b);
+    while (!atomic_load(&bench.done)) {
+        taskYIELD();
+    }
+    ring_buffer_free(bench.ring);
+    return errors ? -1 : 0;
+}
+
+// Send every message back on the reply ring
+static void bench_ring_echo_task(void *p) {
+    bench_ring_t *bench = (bench_ring_t *)p;
+    unsigned char message[bench->chunk];
+    for (int i = 0; i < bench->count; i++) {
+        int read = 0;
+        while ((read += ring_buffer_read(bench->ring, message + read, bench->chunk - read)) < bench->chunk) {
+            taskYIELD();
+        }
+        ring_buffer_write(bench->reply, message, bench->chunk);
+    }
+    atomic_store(&bench->done, 1);
+    vTaskDelete(NULL);
+}
+
+// Round trip of a b->arg byte message through two rings and a second task
+int bench_ring_pingpong(bench_t *b) {
+    bench_ring_t bench = { .count = b->n, .chunk = b->arg };
+    bench.ring = ring_buffer_new(BENCH_RING_CAPACITY);
+    bench.reply = ring_buffer_new(BENCH_RING_CAPACITY);
+    if (!bench.ring || !bench.reply) {
+        ring_buffer_free(bench.ring);
+        ring_buffer_free(bench.reply);
+        return -1;
+    }
+    atomic_init(&bench.done, 0);
+    int errors = 0;
+    unsigned char message[b->arg];
+    if (xTaskCreate(bench_ring_echo_task, "bench_ring", BENCH_RING_TASK_STACK, &bench, BENCH_RING_TASK_PRIORITY, NULL) != pdPASS) {
+        ring_buffer_free(bench.ring);
+        ring_buffer_free(bench.reply);
+        return -1;
+    }
+    bench_reset_timer(b);
+    for (int i = 0; i < b->n; i++) {
+        memset(message, i, b->arg);
+        ring_buffer_write(bench.ring, message, b->arg);
+        int read = 0;
+        while ((read += ring_buffer_read(bench.reply, message + read, b->arg - read)) < b->arg) {
+            taskYIELD();
+        }
+        errors += (message[0] != (unsigned char)i);
+    }
+    bench_stop_timer(b);
+    while (!atomic_load(&bench.done)) {
+        taskYIELD();
+    }
+    ring_buffer_free(bench.ring);
+    ring_buffer_free(bench.reply);
+    return errors ? -1 : 0;
+}
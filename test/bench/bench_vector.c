@@ -0,0 +1,93 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+#include <stdlib.h>
+#include "bench.h"
+
+// A small record, the kind of element that would otherwise be boxed into an array_t
+typedef struct {
+    uint32_t key;
+    uint32_t flags;
+    int64_t value;
+} bench_record_t;
+
+UTILS_DECLARE_VECTOR(bench_records, bench_record_t)
+
+static int bench_vector_compare(const void *a, const void *b) {
+    uint32_t x = ((const bench_record_t *)a)->key;
+    uint32_t y = ((const bench_record_t *)b)->key;
+    return (x > y) - (x < y);
+}
+
+// Keys are a permutation of 0..count-1, so that the sorted sum can be checked
+static uint32_t bench_vector_key(int i, int count) {
+    return (uint32_t)(((uint64_t)i * 7919) % count);
+}
+
+// Build b->arg records, sort them by key and sum them up, with one heap block per record
+int bench_vector_boxed(bench_t *b) {
+    int64_t sum = 0;
+    for (int i = 0; i < b->n; i++) {
+        array_t array = array_new(free);
+        for (int j = 0; j < b->arg; j++) {
+            bench_record_t *record = (bench_record_t *)malloc(sizeof(bench_record_t));
+            record->key = bench_vector_key(j, b->arg);
+            record->flags = 0;
+            record->value = j;
+            array_push(array, record);
+        }
+        array_sort(array, bench_vector_compare);
+        for (int j = 0; j < array_count(array); j++) {
+            sum += ((bench_record_t *)array_at(array, j))->key;
+        }
+        array_free(array);
+    }
+    bench_sink = (uintptr_t)sum;
+    return sum == (int64_t)b->n * b->arg * (b->arg - 1) / 2 ? 0 : -1;
+}
+
+// Same as above with the records stored inline
+int bench_vector_inline(bench_t *b) {
+    int64_t sum = 0;
+    for (int i = 0; i < b->n; i++) {
+        bench_records_t vector = bench_records_new(NULL);
+        for (int j = 0; j < b->arg; j++) {
+            bench_record_t record = { .key = bench_vector_key(j, b->arg), .value = j };
+            bench_records_push(vector, record);
+        }
+        bench_records_sort(vector, bench_vector_compare);
+        bench_record_t *records = bench_records_data(vector);
+        for (int j = 0; j < bench_records_count(vector); j++) {
+            sum += records[j].key;
+        }
+        bench_records_free(vector);
+    }
+    bench_sink = (uintptr_t)sum;
+    return sum == (int64_t)b->n * b->arg * (b->arg - 1) / 2 ? 0 : -1;
+}
@@ -0,0 +1,115 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+// Host runner for the benchmarks.
+// Usage: utils_bench [--quick] [filter]
+
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "bench.h"
+
+#define BENCH_QUICK_SCALE_DOWN      100
+
+#if defined(__GLIBC__) && defined(BENCH_COUNT_ALLOCS)
+// Count allocations by interposing the allocator. Allocations made inside
+// libc, such as by strdup, go through these too. Sanitizers replace the
+// allocator as well, so this is left out of their builds.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static long bench_allocs;
+static long bench_bytes;
+
+static void bench_count(size_t size) {
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bench_bytes, (long)size, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size) {
+    bench_count(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    bench_count(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    bench_count(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+bool bench_alloc_counters(long *count, long *bytes) {
+    *count = __atomic_load_n(&bench_allocs, __ATOMIC_RELAXED);
+    *bytes = __atomic_load_n(&bench_bytes, __ATOMIC_RELAXED);
+    return true;
+}
+#else
+bool bench_alloc_counters(long *count, long *bytes) {
+    *count = 0;
+    *bytes = 0;
+    return false;
+}
+#endif
+
+int64_t bench_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    int scale_down = 1;
+    const char *filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--quick")) {
+            scale_down = BENCH_QUICK_SCALE_DOWN;
+        }
+        else {
+            filter = argv[i];
+        }
+    }
+    // Report on the real stdout, and silence what the benchmarks print
+    FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out || !freopen("/dev/null", "w", stdout)) {
+        return 1;
+    }
+    setvbuf(out, NULL, _IOLBF, 0);
+    int failed = bench_run(out, filter, scale_down);
+    fclose(out);
+    return failed ? 1 : 0;
+}
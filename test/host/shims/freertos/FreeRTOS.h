@@ -0,0 +1,69 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+// Host stand-in for the parts of FreeRTOS pulled in by esp32-utils
+
+#ifndef _UTILS_HOST_FREERTOS_H_
+#define _UTILS_HOST_FREERTOS_H_
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// Critical sections are plain mutexes
+typedef pthread_mutex_t portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED                    PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux)                         pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)                          pthread_mutex_unlock(mux)
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE                                         0
+#define pdTRUE                                          1
+#define pdPASS                                          pdTRUE
+#define portMAX_DELAY                                   ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS                              1
+#define portNUM_PROCESSORS                              2
+
+// Threads are numbered as they first ask, and spread over the "cores" like tasks would be
+static inline BaseType_t xPortGetCoreID(void) {
+    static int next_id;
+    static _Thread_local int id = -1;
+    if (id < 0) {
+        id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+    }
+    return id;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+// Host stand-in for FreeRTOS mutexes and binary semaphores
+
+#ifndef _UTILS_HOST_FREERTOS_SEMPHR_H_
+#define _UTILS_HOST_FREERTOS_SEMPHR_H_
+
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+
+// Mutexes are plain pthread mutexes. Binary semaphores add a flag and a condition to it
+struct _host_semaphore {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool binary;
+    bool given;
+};
+
+typedef struct _host_semaphore *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t host_semaphore_new(bool binary) {
+    SemaphoreHandle_t semaphore;
+    if ((semaphore = (SemaphoreHandle_t)malloc(sizeof(struct _host_semaphore)))) {
+        pthread_mutex_init(&semaphore->mutex, NULL);
+        pthread_cond_init(&semaphore->cond, NULL);
+        semaphore->binary = binary;
+        semaphore->given = false;
+    }
+    return semaphore;
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return host_semaphore_new(false);
+}
+
+// Created empty, as in FreeRTOS
+static inline SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return host_semaphore_new(true);
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    pthread_cond_destroy(&semaphore->cond);
+    pthread_mutex_destroy(&semaphore->mutex);
+    free(semaphore);
+}
+
+// Mutexes always wait forever, binary semaphores honour the timeout
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    if (!semaphore->binary) {
+        return pthread_mutex_lock(&semaphore->mutex) ? pdFALSE : pdTRUE;
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&semaphore->mutex);
+    int ret = 0;
+    while (!semaphore->given && !ret) {
+        ret = (ticks == portMAX_DELAY) ? pthread_cond_wait(&semaphore->cond, &semaphore->mutex) :
+                                         pthread_cond_timedwait(&semaphore->cond, &semaphore->mutex, &deadline);
+    }
+    bool taken = semaphore->given;
+    semaphore->given = false;
+    pthread_mutex_unlock(&semaphore->mutex);
+    return taken ? pdTRUE : pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    if (!semaphore->binary) {
+        return pthread_mutex_unlock(&semaphore->mutex) ? pdFALSE : pdTRUE;
+    }
+    pthread_mutex_lock(&semaphore->mutex);
+    bool was_given = semaphore->given;
+    semaphore->given = true;
+    pthread_cond_signal(&semaphore->cond);
+    pthread_mutex_unlock(&semaphore->mutex);
+    return was_given ? pdFALSE : pdTRUE;
+}
+
+#endif
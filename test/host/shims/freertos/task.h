@@ -0,0 +1,87 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+
+// Host stand-in for FreeRTOS tasks, which run as detached threads
+
+#ifndef _UTILS_HOST_FREERTOS_TASK_H_
+#define _UTILS_HOST_FREERTOS_TASK_H_
+
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef pthread_t TaskHandle_t;
+
+struct _host_task {
+    TaskFunction_t function;
+    void *parameters;
+};
+
+static void *host_task_run(void *p) {
+    struct _host_task task = *(struct _host_task *)p;
+    free(p);
+    task.function(task.parameters);
+    return NULL;
+}
+
+static inline BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth,
+                                     void *parameters, UBaseType_t priority, TaskHandle_t *handle) {
+    pthread_t thread;
+    struct _host_task *task;
+    if (!(task = (struct _host_task *)malloc(sizeof(struct _host_task)))) {
+        return pdFALSE;
+    }
+    task->function = function;
+    task->parameters = parameters;
+    if (pthread_create(&thread, NULL, host_task_run, task)) {
+        free(task);
+        return pdFALSE;
+    }
+    pthread_detach(thread);
+    if (handle) {
+        *handle = thread;
+    }
+    return pdPASS;
+}
+
+// Only deleting the calling task is supported
+#define vTaskDelete(handle)                             pthread_exit(NULL)
+#define vTaskDelay(ticks)                               usleep((ticks) * portTICK_PERIOD_MS * 1000)
+#define taskYIELD()                                     sched_yield()
+
+// Milliseconds of the monotonic clock, as portTICK_PERIOD_MS is 1
+static inline TickType_t xTaskGetTickCount(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (TickType_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+#endif
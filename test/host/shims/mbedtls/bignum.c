@@ -0,0 +1,168 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include <stdlib.h>
+#include <string.h>
+#include "mbedtls/bignum.h"
+
+// Bytes per limb
+#define ciL                                             (sizeof(mbedtls_mpi_uint))
+
+void mbedtls_mpi_init(mbedtls_mpi *X) {
+    X->s = 1;
+    X->n = 0;
+    X->p = NULL;
+}
+
+void mbedtls_mpi_free(mbedtls_mpi *X) {
+    if (X->p) {
+        memset(X->p, 0, X->n * ciL);
+        free(X->p);
+    }
+    mbedtls_mpi_init(X);
+}
+
+int mbedtls_mpi_grow(mbedtls_mpi *X, size_t nblimbs) {
+    if (X->n < nblimbs) {
+        mbedtls_mpi_uint *p;
+        if (!(p = (mbedtls_mpi_uint *)calloc(nblimbs, ciL))) {
+            return MBEDTLS_ERR_MPI_ALLOC_FAILED;
+        }
+        if (X->p) {
+            memcpy(p, X->p, X->n * ciL);
+            memset(X->p, 0, X->n * ciL);
+            free(X->p);
+        }
+        X->n = nblimbs;
+        X->p = p;
+    }
+    return 0;
+}
+
+size_t mbedtls_mpi_bitlen(const mbedtls_mpi *X) {
+    size_t i = X->n;
+    while (i > 0 && !X->p[i - 1]) {
+        i--;
+    }
+    if (!i) {
+        return 0;
+    }
+    size_t bits = 0;
+    for (mbedtls_mpi_uint top = X->p[i - 1]; top; top >>= 1) {
+        bits++;
+    }
+    return (i - 1) * ciL * 8 + bits;
+}
+
+size_t mbedtls_mpi_size(const mbedtls_mpi *X) {
+    return (mbedtls_mpi_bitlen(X) + 7) >> 3;
+}
+
+int mbedtls_mpi_lset(mbedtls_mpi *X, int z) {
+    int ret;
+    if ((ret = mbedtls_mpi_grow(X, 1))) {
+        return ret;
+    }
+    memset(X->p, 0, X->n * ciL);
+    X->p[0] = (mbedtls_mpi_uint)(z < 0 ? -z : z);
+    X->s = (z < 0) ? -1 : 1;
+    return 0;
+}
+
+int mbedtls_mpi_get_bit(const mbedtls_mpi *X, size_t pos) {
+    if (X->n * ciL * 8 <= pos) {
+        return 0;
+    }
+    return (X->p[pos / (ciL * 8)] >> (pos % (ciL * 8))) & 1;
+}
+
+int mbedtls_mpi_cmp_mpi(const mbedtls_mpi *X, const mbedtls_mpi *Y) {
+    size_t i = X->n, j = Y->n;
+    while (i > 0 && !X->p[i - 1]) {
+        i--;
+    }
+    while (j > 0 && !Y->p[j - 1]) {
+        j--;
+    }
+    if (!i && !j) {
+        return 0;
+    }
+    if (i > j) {
+        return X->s;
+    }
+    if (j > i) {
+        return -Y->s;
+    }
+    if (X->s != Y->s) {
+        return X->s;
+    }
+    for (; i > 0; i--) {
+        if (X->p[i - 1] > Y->p[i - 1]) {
+            return X->s;
+        }
+        if (X->p[i - 1] < Y->p[i - 1]) {
+            return -X->s;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_mpi_cmp_int(const mbedtls_mpi *X, int z) {
+    mbedtls_mpi_uint limb = (mbedtls_mpi_uint)(z < 0 ? -z : z);
+    mbedtls_mpi Y = { .s = (z < 0) ? -1 : 1, .n = 1, .p = &limb };
+    return mbedtls_mpi_cmp_mpi(X, &Y);
+}
+
+int mbedtls_mpi_read_binary(mbedtls_mpi *X, const unsigned char *buf, size_t buflen) {
+    int ret;
+    if ((ret = mbedtls_mpi_grow(X, (buflen + ciL - 1) / ciL))) {
+        return ret;
+    }
+    if (X->p) {
+        memset(X->p, 0, X->n * ciL);
+    }
+    X->s = 1;
+    for (size_t i = 0; i < buflen; i++) {
+        X->p[i / ciL] |= ((mbedtls_mpi_uint)buf[buflen - 1 - i]) << ((i % ciL) * 8);
+    }
+    return 0;
+}
+
+int mbedtls_mpi_write_binary(const mbedtls_mpi *X, unsigned char *buf, size_t buflen) {
+    size_t size = mbedtls_mpi_size(X);
+    if (buflen < size) {
+        return MBEDTLS_ERR_MPI_BUFFER_TOO_SMALL;
+    }
+    memset(buf, 0, buflen);
+    for (size_t i = 0; i < size; i++) {
+        buf[buflen - 1 - i] = (unsigned char)(X->p[i / ciL] >> ((i % ciL) * 8));
+    }
+    return 0;
+}
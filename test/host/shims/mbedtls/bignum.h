@@ -0,0 +1,70 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+// Host stand-in for the subset of the mbedtls bignum API used by esp32-utils.
+// Limbs are 32 bits wide, as on the ESP32.
+
+#ifndef _UTILS_HOST_MBEDTLS_BIGNUM_H_
+#define _UTILS_HOST_MBEDTLS_BIGNUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBEDTLS_ERR_MPI_BAD_INPUT_DATA                    -0x0004
+#define MBEDTLS_ERR_MPI_BUFFER_TOO_SMALL                  -0x0008
+#define MBEDTLS_ERR_MPI_ALLOC_FAILED                      -0x0010
+
+typedef uint32_t mbedtls_mpi_uint;
+
+// As in mbedtls 3, the fields are private to the library, so that code relying on them doesn't
+// build on the host either
+#if defined(MBEDTLS_ALLOW_PRIVATE_ACCESS)
+#define MBEDTLS_PRIVATE(member)                         member
+#else
+#define MBEDTLS_PRIVATE(member)                         private_##member
+#endif
+
+typedef struct {
+    int MBEDTLS_PRIVATE(s);
+    size_t MBEDTLS_PRIVATE(n);
+    mbedtls_mpi_uint *MBEDTLS_PRIVATE(p);
+} mbedtls_mpi;
+
+void mbedtls_mpi_init(mbedtls_mpi *X);
+void mbedtls_mpi_free(mbedtls_mpi *X);
+int mbedtls_mpi_grow(mbedtls_mpi *X, size_t nblimbs);
+size_t mbedtls_mpi_bitlen(const mbedtls_mpi *X);
+size_t mbedtls_mpi_size(const mbedtls_mpi *X);
+int mbedtls_mpi_lset(mbedtls_mpi *X, int z);
+int mbedtls_mpi_get_bit(const mbedtls_mpi *X, size_t pos);
+int mbedtls_mpi_cmp_mpi(const mbedtls_mpi *X, const mbedtls_mpi *Y);
+int mbedtls_mpi_cmp_int(const mbedtls_mpi *X, int z);
+int mbedtls_mpi_read_binary(mbedtls_mpi *X, const unsigned char *buf, size_t buflen);
+int mbedtls_mpi_write_binary(const mbedtls_mpi *X, unsigned char *buf, size_t buflen);
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * A collection of utilities for ESP32
+ *
+ * Copyright (c) 2018 Emmanuel Merali
+ * https://github.com/ifullgaz/esp32-utils
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+// Host checks of the CBOR encoder and decoder on malformed and nested input.
+// Usage: utils_test_cbor
+
+#include "esp32-utils/utils.h"
+
+#define CHECK(condition)                                                                                \
+    do {                                                                                                \
+        if (!(condition)) {                                                                             \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                        \
+            failures++;                                                                                 \
+        }                                                                                               \
+    } while (0)
+
+static int failures;
+
+static int test_decode(const unsigned char *data, int len, cbor_type_t *type, void **value) {
+    *value = NULL;
+    return cbor_decode(data, len, type, value);
+}
+
+static void test_free(cbor_type_t type, void *value) {
+    element_free *free_callback = cbor_free_callback_for_type(type);
+    if (free_callback && value) {
+        free_callback(value);
+    }
+}
+
+// Nested containers of every type, with nulls and empty containers
+static map_t test_nested(void) {
+    map_t root = map_new(map_free);
+    map_t numbers = map_new(cbor_uint_free);
+    map_t strings = map_new(free);
+    map_t lists = map_new(array_free);
+    array_t buffers = array_new(buffer_free);
+    array_t mpis = array_new(utils_mpi_free);
+    array_t matrix = array_new(array_free);
+    map_set_value_for_key(numbers, "zero", (void *)0);
+    map_set_value_for_key(numbers, "large", (void *)(uintptr_t)UINT32_MAX);
+    map_set_value_for_key(strings, "text", strdup("value"));
+    map_set_value_for_key(strings, "none", NULL);
+    buffer_t buffer = buffer_new(0);
+    buffer_append_string(buffer, "bytes");
+    array_push(buffers, buffer);
+    array_push(buffers, NULL);
+    mbedtls_mpi *mpi = utils_mpi_new();
+    mbedtls_mpi_lset(mpi, 0x12345678);
+    array_push(mpis, mpi);
+    for (int i = 0; i < 3; i++) {
+        array_t row = array_new(cbor_uint_free);
+        for (int j = 0; j < i; j++) {
+            array_push(row, (void *)(uintptr_t)(i * 100 + j));
+        }
+        array_push(matrix, row);
+    }
+    map_set_value_for_key(lists, "buffers", buffers);
+    map_set_value_for_key(lists, "mpis", mpis);
+    map_set_value_for_key(lists, "matrix", matrix);
+    map_set_value_for_key(root, "numbers", numbers);
+    map_set_value_for_key(root, "strings", strings);
+    map_set_value_for_key(root, "lists", lists);
+    map_set_value_for_key(root, "empty", map_new(NULL));
+    return root;
+}
+
+static void test_nested_round_trip(void) {
+    map_t map = test_nested();
+    buffer_t encoded = buffer_new(0);
+    buffer_t again = buffer_new(0);
+    cbor_type_t type;
+    void *decoded;
+    CHECK(cbor_append_map(encoded, map) == UTILS_ERR_OK);
+    CHECK(test_decode(buffer_get_data(encoded), buffer_get_length(encoded), &type, &decoded) == UTILS_ERR_OK);
+    CHECK(type == CBOR_TYPE_MAP);
+    if (decoded) {
+        map_t lists = (map_t)map_value_for_key(decoded, "lists");
+        map_t numbers = (map_t)map_value_for_key(decoded, "numbers");
+        map_t strings = (map_t)map_value_for_key(decoded, "strings");
+        CHECK(map_count(decoded) == 4);
+        CHECK(numbers && map_get_free_callback(numbers) == cbor_uint_free);
+        CHECK(numbers && map_value_for_key(numbers, "large") == (void *)(uintptr_t)UINT32_MAX);
+        CHECK(strings && !strcmp((const char *)map_value_for_key(strings, "text"), "value"));
+        CHECK(strings && !map_value_for_key(strings, "none") && map_count(strings) == 2);
+        array_t matrix = lists ? (array_t)map_value_for_key(lists, "matrix") : NULL;
+        CHECK(matrix && array_count(matrix) == 3);
+        CHECK(matrix && array_at(array_at(matrix, 2), 1) == (void *)201);
+        CHECK(cbor_append_map(again, decoded) == UTILS_ERR_OK);
+        CHECK(buffer_get_length(again) == buffer_get_length(encoded) &&
+            !memcmp(buffer_get_data(again), buffer_get_data(encoded), buffer_get_length(encoded)));
+        map_free(decoded);
+    }
+    buffer_free(again);
+    buffer_free(encoded);
+    map_free(map);
+}
+
+// Every prefix of a valid encoding must be rejected, without leaking what was decoded
+static void test_truncated(void) {
+    map_t map = test_nested();
+    buffer_t encoded = buffer_new(0);
+    cbor_append_map(encoded, map);
+    for (int len = 0; len < buffer_get_length(encoded); len++) {
+        cbor_type_t type;
+        void *decoded;
+        int ret = test_decode(buffer_get_data(encoded), len, &type, &decoded);
+        CHECK(ret == UTILS_ERR_INVALID_DATA);
+        if (ret == UTILS_ERR_OK) {
+            test_free(type, decoded);
+        }
+    }
+    buffer_free(encoded);
+    map_free(map);
+}
+
+static void test_duplicate_keys(void) {
+    // {"a": "x", "a": "y"} and {"k": {}, "k": {}}
+    const unsigned char strings[] = { 0xa2, 0x61, 'a', 0x61, 'x', 0x61, 'a', 0x61, 'y' };
+    const unsigned char maps[] = { 0xa2, 0x61, 'k', 0xa0, 0x61, 'k', 0xa0 };
+    // {"a": null, "a": null}, which has no values to tell the entries apart
+    const unsigned char nulls[] = { 0xa2, 0x61, 'a', 0xf6, 0x61, 'a', 0xf6 };
+    cbor_type_t type;
+    void *decoded;
+    CHECK(test_decode(strings, sizeof(strings), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+    CHECK(test_decode(maps, sizeof(maps), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+    CHECK(test_decode(nulls, sizeof(nulls), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+}
+
+static void test_malformed(void) {
+    // Mixed element types, a count larger than the data, a key that isn't text,
+    // an indefinite length, trailing bytes and a \0 inside text
+    const unsigned char mixed[] = { 0x82, 0x01, 0x61, 'x' };
+    const unsigned char count[] = { 0x9a, 0xff, 0xff, 0xff, 0xff, 0x01 };
+    const unsigned char key[] = { 0xa1, 0x01, 0x01 };
+    const unsigned char indefinite[] = { 0x9f, 0x01, 0xff };
+    const unsigned char trailing[] = { 0x01, 0x01 };
+    // "a\0b" as a string and as a key, which would come back cut short
+    const unsigned char nul[] = { 0x63, 'a', 0x00, 'b' };
+    const unsigned char nul_key[] = { 0xa1, 0x63, 'a', 0x00, 'b', 0x01 };
+    unsigned char deep[CBOR_MAX_DEPTH + 2];
+    cbor_type_t type;
+    void *decoded;
+    memset(deep, 0x81, sizeof(deep) - 1);
+    deep[sizeof(deep) - 1] = 0x01;
+    CHECK(test_decode(mixed, sizeof(mixed), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+    CHECK(test_decode(count, sizeof(count), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+    CHECK(test_decode(key, sizeof(key), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+    CHECK(test_decode(indefinite, sizeof(indefinite), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+    CHECK(test_decode(trailing, sizeof(trailing), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+    CHECK(test_decode(nul, sizeof(nul), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+    CHECK(test_decode(nul_key, sizeof(nul_key), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+    CHECK(test_decode(deep, sizeof(deep), &type, &decoded) == UTILS_ERR_INVALID_DATA);
+}
+
+// Containers without a free callback can't say what their elements are
+static void test_untyped(void) {
+    int borrowed;
+    array_t nulls = array_new(NULL);
+    array_t pointers = array_new(NULL);
+    buffer_t buffer = buffer_new(0);
+    array_push(nulls, NULL);
+    array_push(pointers, &borrowed);
+    CHECK(cbor_append_array(buffer, nulls) == UTILS_ERR_OK);
+    CHECK(buffer_get_length(buffer) == 2);
+    CHECK(cbor_append_array(buffer, pointers) == UTILS_ERR_NOT_SUPPORTED);
+    CHECK(buffer_get_length(buffer) == 2);
+    buffer_free(buffer);
+    array_free(pointers);
+    array_free(nulls);
+}
+
+// Bignums are unsigned, a negative MPI would come back positive
+static void test_negative_mpi(void) {
+    mbedtls_mpi *mpi = utils_mpi_new();
+    buffer_t buffer = buffer_new(0);
+    mbedtls_mpi_lset(mpi, -5);
+    CHECK(cbor_append(buffer, CBOR_TYPE_MPI, mpi) == UTILS_ERR_NOT_SUPPORTED);
+    CHECK(buffer_get_length(buffer) == 0);
+    mbedtls_mpi_lset(mpi, 5);
+    CHECK(cbor_append(buffer, CBOR_TYPE_MPI, mpi) == UTILS_ERR_OK);
+    buffer_free(buffer);
+    utils_mpi_free(mpi);
+}
+
+int main(void) {
+    test_nested_round_trip();
+    test_truncated();
+    test_duplicate_keys();
+    test_malformed();
+    test_untyped();
+    test_negative_mpi();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
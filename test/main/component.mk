@@ -1,3 +1,7 @@
 #
 # Main Makefile. This is basically the same as a component makefile.
 #
+
+# The benchmarks are shared with the host build
+COMPONENT_SRCDIRS := . ../bench
+COMPONENT_PRIV_INCLUDEDIRS := ../bench
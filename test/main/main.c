@@ -28,10 +28,45 @@
 
 #include "freertos/FreeRTOS.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "esp32-utils/utils.h"
+#include "bench.h"
+
+// Keep the run short enough for the task watchdog
+#define BENCH_SCALE_DOWN            10
+
+// A smoke test of each module. The dumps are left out, they would flood the console
+static const char *bench_smoke_filters[] = {
+    "array/push_pop",
+    "deque/queue_deque",
+    "map/get/256",
+    "map/shared_concurrent/2",
+    "buffer/append/16",
+    "buffer/parse_reader",
+    "ring/pingpong",
+    "mpi/new_free/pool",
+    "arena/request/arena",
+    "cbor/round_trip",
+    "frozen/lookup_blob",
+};
 
 static const char *TAG = "UTILS_TEST";
 
+int64_t bench_now_ns(void) {
+    return esp_timer_get_time() * 1000;
+}
+
+bool bench_alloc_counters(long *count, long *bytes) {
+    *count = 0;
+    *bytes = 0;
+    return false;
+}
+
 void app_main() {
+    int failed = 0;
+    for (int i = 0; i < sizeof(bench_smoke_filters) / sizeof(bench_smoke_filters[0]); i++) {
+        failed += bench_run(stdout, bench_smoke_filters[i], BENCH_SCALE_DOWN);
+    }
+    ESP_LOGI(TAG, "Benchmarks done, %d failed", failed);
 }